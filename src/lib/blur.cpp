@@ -1,6 +1,9 @@
 #include <blur.h>
 
-std::vector<cv::Mat> GaussianBlur3D::Blur(size_t ksize) {
+std::vector<cv::Mat> GaussianBlur3D::Blur(size_t ksize,
+                                          const std::vector<cv::Mat>& mask,
+                                          const std::atomic<bool>* cancelled) {
+  const int r = ksize / 2;
   // padding with empty images
   std::vector<cv::Mat> image_tmp;
   std::vector<cv::Mat> blurred;
@@ -11,26 +14,43 @@ std::vector<cv::Mat> GaussianBlur3D::Blur(size_t ksize) {
     cv::Mat mat;
     img.convertTo(mat, CV_64FC1);
     image_tmp.push_back(mat);
-    blurred.push_back(mat);
+    // border pixels keep their values, the source stays untouched
+    blurred.push_back(mat.clone());
   }
   for (size_t i = 0; i < ksize / 2; i++) {
     image_tmp.push_back(cv::Mat::zeros(images_[0].size(), CV_64FC1));
   }
 
-  std::vector<cv::Mat> filter = CreateFilter(ksize);
-  // applying Gaussian filter
-  for (int img_i = ksize / 2; img_i < image_tmp.size() - ksize / 2; img_i++) {
-    for (int i = ksize / 2; i < image_tmp[img_i].rows - ksize / 2; i++) {
-      for (int j = ksize / 2; j < image_tmp[img_i].cols - ksize / 2; j++) {
-        double value = 0;
-        for (int kernel = 0; kernel < ksize; kernel++) {
-          cv::Mat part = image_tmp[img_i - ksize / 2 + kernel](
-              cv::Rect(j - ksize / 2, i - ksize / 2, ksize, ksize));
+  // filter laid out as [image][row][column] for the row kernel
+  std::vector<cv::Mat> filter_mats = CreateFilter(ksize);
+  std::vector<double> filter;
+  for (cv::Mat mat : filter_mats) {
+    filter.insert(filter.end(), mat.begin<double>(), mat.end<double>());
+  }
 
-          value += cv::sum(part.mul(filter[kernel])).val[0];
+  // applying Gaussian filter
+  const Kernels& kernels = ActiveKernels();
+  std::vector<const double*> rows(ksize * ksize);
+  for (int img_i = r; img_i < (int)image_tmp.size() - r; img_i++) {
+    if (cancelled != nullptr && *cancelled) return {};
+    for (int i = r; i < image_tmp[img_i].rows - r; i++) {
+      for (int kernel = 0; kernel < (int)ksize; kernel++) {
+        for (int row = 0; row < (int)ksize; row++) {
+          rows[kernel * ksize + row] =
+              image_tmp[img_i - r + kernel].ptr<double>(i - r + row);
         }
-        blurred[img_i - ksize / 2].at<double>(i, j) = value;
       }
+      double* dst = blurred[img_i - r].ptr<double>(i);
+      if (mask.empty()) {
+        kernels.blur_row(rows.data(), filter.data(), ksize, dst, r,
+                         image_tmp[img_i].cols - r);
+        continue;
+      }
+      ForEachMaskRun(mask[img_i - r].ptr<uint8_t>(i), r,
+                     image_tmp[img_i].cols - r, [&](int from, int to) {
+                       kernels.blur_row(rows.data(), filter.data(), ksize, dst,
+                                        from, to);
+                     });
     }
   }
 
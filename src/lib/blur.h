@@ -1,8 +1,10 @@
 #ifndef BLUR_H
 #define BLUR_H
 
+#include <kernels.h>
 #include <opencv2/core/core_c.h>
 
+#include <atomic>
 #include <cmath>
 #include <opencv2/highgui.hpp>
 #include <opencv2/opencv.hpp>
@@ -29,10 +31,17 @@ class GaussianBlur3D {
    * @brief Размывает изображения
    *
    * @param ksize Размер фильтра, должен быть нечетным
+   * @param mask Маски CV_8UC1 для каждого изображения: размываются только
+   * пиксели с ненулевым значением маски, остальные остаются без изменений.
+   * Если массив пустой, размываются все пиксели
+   * @param cancelled Флаг отмены, проверяется перед каждым изображением
    *
-   * @return Массив размытых изображений
+   * @return Массив размытых изображений или пустой массив, если размытие
+   * отменено
    */
-  std::vector<cv::Mat> Blur(size_t ksize);
+  std::vector<cv::Mat> Blur(size_t ksize,
+                            const std::vector<cv::Mat>& mask = {},
+                            const std::atomic<bool>* cancelled = nullptr);
 
  private:
   std::vector<cv::Mat> images_;
@@ -0,0 +1,229 @@
+#ifndef BRICK_H
+#define BRICK_H
+
+#include <opencv2/core/core_c.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief Объем, разбитый на кубы 8x8x8
+ *
+ * @class BrickVolume
+ * Хранит трехмерный массив кубами по 8x8x8 вокселей, кубы упорядочены по
+ * кривой Мортона (Z-order). Внутри куба воксели лежат по срезам, затем по
+ * строкам. В отличие от массива срезов cv::Mat, все 26 соседей вокселя
+ * обычно лежат в том же кубе, то есть в нескольких соседних строках кэша.
+ *
+ * @tparam T Тип вокселя, должен совпадать с типом срезов cv::Mat
+ */
+template <class T>
+class BrickVolume {
+ public:
+  // bricks are kBrickSize voxels along every axis
+  static constexpr int kBrickBits = 3;
+  static constexpr int kBrickSize = 1 << kBrickBits;
+
+  /**
+   * @brief Создает объем, заполненный нулями
+   *
+   * @param depth Число срезов
+   * @param rows Число строк в срезе
+   * @param cols Число столбцов в срезе
+   */
+  BrickVolume(int depth, int rows, int cols);
+
+  /**
+   * @brief Переводит массив срезов в разбиение на кубы
+   *
+   * @param slices Срезы одинакового размера
+   *
+   * @return Объем
+   */
+  static BrickVolume FromSlices(const std::vector<cv::Mat>& slices);
+
+  /**
+   * @brief Переводит объем в массив срезов
+   *
+   * @return Массив срезов типа cv::DataType<T>::type
+   */
+  std::vector<cv::Mat> ToSlices() const;
+
+  /**
+   * @brief Записывает объем в существующий массив срезов
+   *
+   * @param slices Срезы того же размера и типа, что и объем
+   */
+  void ToSlices(std::vector<cv::Mat>& slices) const;
+
+  T& at(int z, int y, int x) { return data_[Offset(z, y, x)]; }
+  const T& at(int z, int y, int x) const { return data_[Offset(z, y, x)]; }
+
+  int depth() const { return depth_; }
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+
+  /**
+   * @brief Обходит воксели в порядке их расположения в памяти
+   *
+   * @param f Вызывается как f(z, y, x, value) для каждого вокселя объема,
+   * дополнение кубов до полного размера пропускается
+   */
+  template <class F>
+  void ForEach(F f);
+
+ private:
+  int depth_;
+  int rows_;
+  int cols_;
+  // number of bricks along each axis
+  int bricks_z_;
+  int bricks_y_;
+  int bricks_x_;
+  // brick position in Morton order for every brick in (z, y, x) order
+  std::vector<uint32_t> brick_slot_;
+  // brick coordinates for every position in Morton order
+  std::vector<cv::Point3i> slot_brick_;
+  std::vector<T> data_;
+
+  size_t Offset(int z, int y, int x) const {
+    size_t slot =
+        brick_slot_[((size_t)(z >> kBrickBits) * bricks_y_ + (y >> kBrickBits)) *
+                        bricks_x_ +
+                    (x >> kBrickBits)];
+    const int mask = kBrickSize - 1;
+    return (slot << (3 * kBrickBits)) | ((z & mask) << (2 * kBrickBits)) |
+           ((y & mask) << kBrickBits) | (x & mask);
+  }
+
+  // calls f(z, y, x, count, offset) for the rows of the bricks in memory
+  // order; data_[offset] holds count voxels starting at (z, y, x)
+  template <class F>
+  void ForEachBrickRow(F f) const;
+
+  // interleaves the bits of the brick coordinates
+  static uint64_t Morton(uint32_t z, uint32_t y, uint32_t x);
+};
+
+template <class T>
+BrickVolume<T>::BrickVolume(int depth, int rows, int cols)
+    : depth_(depth),
+      rows_(rows),
+      cols_(cols),
+      bricks_z_((depth + kBrickSize - 1) / kBrickSize),
+      bricks_y_((rows + kBrickSize - 1) / kBrickSize),
+      bricks_x_((cols + kBrickSize - 1) / kBrickSize) {
+  size_t bricks = (size_t)bricks_z_ * bricks_y_ * bricks_x_;
+  std::vector<std::pair<uint64_t, uint32_t>> order;
+  for (int bz = 0; bz < bricks_z_; bz++) {
+    for (int by = 0; by < bricks_y_; by++) {
+      for (int bx = 0; bx < bricks_x_; bx++) {
+        order.push_back(std::make_pair(Morton(bz, by, bx), (uint32_t)order.size()));
+      }
+    }
+  }
+  // Morton order of a grid that is not a power of two has gaps, so bricks
+  // are numbered by their rank instead of the code itself
+  std::sort(order.begin(), order.end());
+  brick_slot_.resize(bricks);
+  slot_brick_.resize(bricks);
+  for (size_t slot = 0; slot < bricks; slot++) {
+    uint32_t brick = order[slot].second;
+    brick_slot_[brick] = slot;
+    slot_brick_[slot] = cv::Point3i(brick % bricks_x_,
+                                    brick / bricks_x_ % bricks_y_,
+                                    brick / bricks_x_ / bricks_y_);
+  }
+  data_.assign(bricks << (3 * kBrickBits), T());
+}
+
+template <class T>
+BrickVolume<T> BrickVolume<T>::FromSlices(const std::vector<cv::Mat>& slices) {
+  if (slices.empty()) return BrickVolume(0, 0, 0);
+
+  BrickVolume volume(slices.size(), slices[0].rows, slices[0].cols);
+  std::vector<cv::Mat> converted(slices);
+  for (cv::Mat& slice : converted) {
+    if (slice.type() != cv::DataType<T>::type) {
+      slice.convertTo(slice, cv::DataType<T>::type);
+    }
+  }
+  // brick by brick, so that the writes are sequential; a row of a brick is
+  // contiguous in memory
+  volume.ForEachBrickRow([&](int z, int y, int x, int count, size_t offset) {
+    std::memcpy(&volume.data_[offset], converted[z].ptr<T>(y) + x,
+                count * sizeof(T));
+  });
+  return volume;
+}
+
+template <class T>
+std::vector<cv::Mat> BrickVolume<T>::ToSlices() const {
+  std::vector<cv::Mat> slices;
+  for (int z = 0; z < depth_; z++) {
+    slices.push_back(cv::Mat(rows_, cols_, cv::DataType<T>::type));
+  }
+  ToSlices(slices);
+  return slices;
+}
+
+template <class T>
+void BrickVolume<T>::ToSlices(std::vector<cv::Mat>& slices) const {
+  ForEachBrickRow([&](int z, int y, int x, int count, size_t offset) {
+    std::memcpy(slices[z].ptr<T>(y) + x, &data_[offset], count * sizeof(T));
+  });
+}
+
+template <class T>
+template <class F>
+void BrickVolume<T>::ForEachBrickRow(F f) const {
+  for (size_t slot = 0; slot < slot_brick_.size(); slot++) {
+    const cv::Point3i& brick = slot_brick_[slot];
+    int z0 = brick.z * kBrickSize;
+    int y0 = brick.y * kBrickSize;
+    int x0 = brick.x * kBrickSize;
+    int count = std::min(kBrickSize, cols_ - x0);
+    size_t first_voxel = slot << (3 * kBrickBits);
+    for (int z = z0; z < std::min(z0 + kBrickSize, depth_); z++) {
+      for (int y = y0; y < std::min(y0 + kBrickSize, rows_); y++) {
+        f(z, y, x0, count,
+          first_voxel + ((((z - z0) << kBrickBits) + (y - y0)) << kBrickBits));
+      }
+    }
+  }
+}
+
+template <class T>
+template <class F>
+void BrickVolume<T>::ForEach(F f) {
+  for (size_t slot = 0; slot < slot_brick_.size(); slot++) {
+    const cv::Point3i& brick = slot_brick_[slot];
+    int z0 = brick.z * kBrickSize;
+    int y0 = brick.y * kBrickSize;
+    int x0 = brick.x * kBrickSize;
+    T* voxel = &data_[slot << (3 * kBrickBits)];
+    for (int z = z0; z < z0 + kBrickSize; z++) {
+      for (int y = y0; y < y0 + kBrickSize; y++) {
+        for (int x = x0; x < x0 + kBrickSize; x++, voxel++) {
+          if (z < depth_ && y < rows_ && x < cols_) f(z, y, x, *voxel);
+        }
+      }
+    }
+  }
+}
+
+template <class T>
+uint64_t BrickVolume<T>::Morton(uint32_t z, uint32_t y, uint32_t x) {
+  uint64_t code = 0;
+  for (int bit = 0; bit < 21; bit++) {
+    code |= (uint64_t)((x >> bit) & 1) << (3 * bit);
+    code |= (uint64_t)((y >> bit) & 1) << (3 * bit + 1);
+    code |= (uint64_t)((z >> bit) & 1) << (3 * bit + 2);
+  }
+  return code;
+}
+
+#endif
@@ -1,29 +1,175 @@
 #include <canny.h>
+#include <hysteresis.h>
+
+#include <algorithm>
+#include <iostream>
 
 std::vector<cv::Mat> Canny3D::DetectEdges(std::vector<cv::Mat>& images,
                                           int low_threshold, int high_threshold,
-                                          double sobel_coef, int blur_ksize) {
-  std::cout << "Applying Gaussian filter" << std::endl;
+                                          double sobel_coef, int blur_ksize,
+                                          const std::atomic<bool>* cancelled) {
+  // intermediate results are locals, so returning early frees them
+  auto stop = [cancelled]() { return cancelled != nullptr && *cancelled; };
+
+  Log("Applying Gaussian filter");
   // Gaussian filter
-  std::vector<cv::Mat> blurred_images = GaussianBlur3D(images).Blur(blur_ksize);
+  std::vector<cv::Mat> blurred_images =
+      GaussianBlur3D(images).Blur(blur_ksize, {}, cancelled);
+  if (stop()) return {};
 
-  std::cout << "Counting gradients" << std::endl;
-  SobelOperator sop(blurred_images, sobel_coef);
+  Log("Counting gradients");
+  SobelOperator sop(blurred_images, sobel_coef, {}, cancelled);
+
+  // the gradients are counted lazily by the first stage that needs them
+  Log("Non-maximum suppression stage");
+  std::vector<cv::Mat> edge_images = NonMaximumSuppression(sop, {}, cancelled);
+  if (stop()) return {};
+
+  Log("Double thresholding stage");
+  DoubleThresholding(edge_images, low_threshold, high_threshold);
+  if (stop()) return {};
+
+  Log("Detecting edges");
+  EdgeTrackingByHysteresis(edge_images);
+
+  Log("End of detection");
+  return edge_images;
+}
+
+std::vector<cv::Mat> Canny3D::DetectEdgesCoarseToFine(
+    std::vector<cv::Mat>& images, int low_threshold, int high_threshold,
+    double sobel_coef, int blur_ksize, int band_radius) {
+  Log("Searching for candidate edges on the downsampled volume");
+  std::vector<cv::Mat> band = FindCandidateBand(
+      images, low_threshold, sobel_coef, blur_ksize, band_radius);
+  if (band.empty()) {
+    return DetectEdges(images, low_threshold, high_threshold, sobel_coef,
+                       blur_ksize);
+  }
+
+  // every stage needs the previous one in a 3x3x3 neighbourhood
+  std::vector<cv::Mat> sobel_mask = DilateMask(band, 1);
+  std::vector<cv::Mat> blur_mask = DilateMask(sobel_mask, 1);
+  // the first and the last images are neither suppressed nor thresholded and
+  // keep the whole gradient like in DetectEdges, so it is counted everywhere
+  // on them and on the images their gradient is taken from
+  const size_t last_img = images.size() - 1;
+  for (size_t img_i : {(size_t)0, (size_t)1, last_img - 1, last_img}) {
+    blur_mask[img_i].setTo(cv::Scalar(255));
+  }
+  sobel_mask[0].setTo(cv::Scalar(255));
+  sobel_mask[last_img].setTo(cv::Scalar(255));
+
+  Log("Applying Gaussian filter");
+  std::vector<cv::Mat> blurred_images =
+      GaussianBlur3D(images).Blur(blur_ksize, blur_mask);
 
-  std::cout << "Non-maximum suppression stage" << std::endl;
-  std::vector<cv::Mat> edge_images = NonMaximumSuppression(sop);
+  Log("Counting gradients");
+  SobelOperator sop(blurred_images, sobel_coef, sobel_mask);
 
-  std::cout << "Double thresholding stage" << std::endl;
+  Log("Non-maximum suppression stage");
+  std::vector<cv::Mat> edge_images = NonMaximumSuppression(sop, band);
+
+  Log("Double thresholding stage");
   DoubleThresholding(edge_images, low_threshold, high_threshold);
 
-  std::cout << "Detecting edges" << std::endl;
+  Log("Detecting edges");
   EdgeTrackingByHysteresis(edge_images);
 
-  std::cout << "End of detection" << std::endl;
+  Log("End of detection");
   return edge_images;
 }
 
-std::vector<cv::Mat> Canny3D::NonMaximumSuppression(SobelOperator& sop) {
+std::vector<cv::Mat> Canny3D::FindCandidateBand(std::vector<cv::Mat>& images,
+                                                int low_threshold,
+                                                double sobel_coef,
+                                                int blur_ksize,
+                                                int band_radius) {
+  std::vector<cv::Mat> coarse = Downsample(images);
+  if (coarse.size() < 3 || coarse[0].rows < 3 || coarse[0].cols < 3) {
+    return {};
+  }
+
+  // the same smoothing in voxels of the downsampled volume
+  int coarse_ksize = std::max(3, (blur_ksize / 2) | 1);
+  std::vector<cv::Mat> blurred_images =
+      GaussianBlur3D(coarse).Blur(coarse_ksize);
+  SobelOperator sop(blurred_images, sobel_coef);
+  std::vector<cv::Mat> coarse_edges = NonMaximumSuppression(sop);
+
+  // the band is dilated on the downsampled volume, where it has 8 times fewer
+  // voxels; a coarse voxel covers 2 voxels along every axis, so half of the
+  // radius there covers at least the whole radius after upsampling
+  std::vector<cv::Mat> coarse_band;
+  for (const cv::Mat& img : coarse_edges) {
+    cv::Mat mask;
+    cv::compare(img, cv::Scalar(low_threshold / 2), mask, cv::CMP_GE);
+    coarse_band.push_back(mask);
+  }
+  coarse_band = DilateMask(coarse_band, (band_radius + 1) / 2);
+
+  std::vector<cv::Mat> band;
+  for (size_t img_i = 0; img_i < images.size(); img_i++) {
+    size_t coarse_i = std::min(img_i / 2, coarse_band.size() - 1);
+    cv::Mat mask;
+    cv::resize(coarse_band[coarse_i], mask, images[img_i].size(), 0, 0,
+               cv::INTER_NEAREST);
+    band.push_back(mask);
+  }
+  return band;
+}
+
+std::vector<cv::Mat> Canny3D::Downsample(const std::vector<cv::Mat>& images) {
+  std::vector<cv::Mat> result;
+  for (size_t img_i = 0; img_i < images.size(); img_i += 2) {
+    cv::Size size(images[img_i].cols / 2, images[img_i].rows / 2);
+    if (size.width == 0 || size.height == 0) return {};
+
+    cv::Mat img;
+    cv::resize(images[img_i], img, size, 0, 0, cv::INTER_AREA);
+    if (img_i + 1 < images.size()) {
+      // averaging pairs of neighbouring slices
+      cv::Mat next;
+      cv::resize(images[img_i + 1], next, size, 0, 0, cv::INTER_AREA);
+      cv::addWeighted(img, 0.5, next, 0.5, 0, img);
+    }
+    result.push_back(img);
+  }
+  return result;
+}
+
+std::vector<cv::Mat> Canny3D::DilateMask(const std::vector<cv::Mat>& mask,
+                                         int radius) {
+  if (radius <= 0) return mask;
+
+  // in-plane dilation, then along the axis between images
+  cv::Mat kernel = cv::Mat::ones(2 * radius + 1, 2 * radius + 1, CV_8UC1);
+  std::vector<cv::Mat> planar;
+  for (const cv::Mat& img : mask) {
+    cv::Mat dilated;
+    cv::dilate(img, dilated, kernel);
+    planar.push_back(dilated);
+  }
+
+  std::vector<cv::Mat> result;
+  for (int img_i = 0; img_i < (int)planar.size(); img_i++) {
+    cv::Mat dilated = planar[img_i].clone();
+    for (int k = std::max(0, img_i - radius);
+         k <= std::min((int)planar.size() - 1, img_i + radius); k++) {
+      cv::max(dilated, planar[k], dilated);
+    }
+    result.push_back(dilated);
+  }
+  return result;
+}
+
+void Canny3D::Log(const char* message) const {
+  if (verbose_) std::cout << message << std::endl;
+}
+
+std::vector<cv::Mat> Canny3D::NonMaximumSuppression(
+    SobelOperator& sop, const std::vector<cv::Mat>& mask,
+    const std::atomic<bool>* cancelled) {
   std::vector<cv::Mat> grads = sop.getGradient();
   std::vector<std::pair<cv::Mat, cv::Mat>> neighb_grads =
       sop.getNeighbourGrads();
@@ -32,23 +178,35 @@ std::vector<cv::Mat> Canny3D::NonMaximumSuppression(SobelOperator& sop) {
   std::vector<cv::Mat> ydir = sop.getGradDirectionY();
   std::vector<cv::Mat> zdir = sop.getGradDirectionZ();
 
+  const Kernels& kernels = ActiveKernels();
   for (size_t img_i = 1; img_i < grads.size() - 1; img_i++) {
-    for (size_t i = 1; i < grads[img_i].rows - 1; i++) {
-      for (size_t j = 1; j < grads[img_i].cols - 1; j++) {
-        int dx = xdir[img_i].at<int32_t>(i, j);
-        int dy = ydir[img_i].at<int32_t>(i, j);
-        int dz = zdir[img_i].at<int32_t>(i, j);
-        if (dz == 1) {
-          dx = -dx;
-          dy = -dy;
-        }
-        if (grads[img_i].at<int32_t>(i, j) <
-                neighb_grads[img_i].first.at<int32_t>(i + dy, j + dx) ||
-            grads[img_i].at<int32_t>(i, j) <
-                neighb_grads[img_i].second.at<int32_t>(i - dy, j - dx)) {
-          suppressed_grads[img_i].at<int32_t>(i, j) = 0;
-        }
+    if (cancelled != nullptr && *cancelled) return {};
+    for (int i = 1; i < grads[img_i].rows - 1; i++) {
+      const int32_t* first_rows[3];
+      const int32_t* second_rows[3];
+      for (int row = 0; row < 3; row++) {
+        first_rows[row] = neighb_grads[img_i].first.ptr<int32_t>(i - 1 + row);
+        second_rows[row] =
+            neighb_grads[img_i].second.ptr<int32_t>(i - 1 + row);
+      }
+      auto suppress_run = [&](int from, int to) {
+        kernels.nms_row(grads[img_i].ptr<int32_t>(i),
+                        xdir[img_i].ptr<int32_t>(i),
+                        ydir[img_i].ptr<int32_t>(i),
+                        zdir[img_i].ptr<int32_t>(i), first_rows, second_rows,
+                        suppressed_grads[img_i].ptr<int32_t>(i), from, to);
+      };
+
+      if (mask.empty()) {
+        suppress_run(1, grads[img_i].cols - 1);
+        continue;
       }
+      const uint8_t* mask_row = mask[img_i].ptr<uint8_t>(i);
+      int32_t* suppressed_row = suppressed_grads[img_i].ptr<int32_t>(i);
+      for (int j = 0; j < grads[img_i].cols; j++) {
+        if (!mask_row[j]) suppressed_row[j] = 0;
+      }
+      ForEachMaskRun(mask_row, 1, grads[img_i].cols - 1, suppress_run);
     }
 
     cv::normalize(suppressed_grads[img_i], suppressed_grads[img_i], 0, 255,
@@ -68,81 +226,24 @@ std::vector<cv::Mat> Canny3D::NonMaximumSuppression(SobelOperator& sop) {
 
 void Canny3D::DoubleThresholding(std::vector<cv::Mat>& edge_images,
                                  int low_threshold, int high_threshold) {
+  const Kernels& kernels = ActiveKernels();
   for (size_t img_i = 1; img_i < edge_images.size() - 1; img_i++) {
-    for (size_t i = 0; i < edge_images[img_i].rows; i++) {
-      for (size_t j = 0; j < edge_images[img_i].cols; j++) {
-        int value = edge_images[img_i].at<uint8_t>(i, j);
-
-        if (value > high_threshold) {
-          edge_images[img_i].at<uint8_t>(i, j) = 255;
-        } else if (value < low_threshold) {
-          edge_images[img_i].at<uint8_t>(i, j) = 0;
-        } else {
-          edge_images[img_i].at<uint8_t>(i, j) = 127;
-        }
-      }
+    for (int i = 0; i < edge_images[img_i].rows; i++) {
+      kernels.threshold_row(edge_images[img_i].ptr<uint8_t>(i), low_threshold,
+                            high_threshold, 0, edge_images[img_i].cols);
     }
   }
 }
 
 void Canny3D::EdgeTrackingByHysteresis(std::vector<cv::Mat>& edge_images) {
-  std::queue<int> candidate_row;
-  std::queue<int> candidate_col;
-  std::queue<int> candidate_img;
-  for (size_t img_i = 1; img_i < edge_images.size() - 1; img_i++) {
-    for (size_t row_i = 0; row_i < edge_images[img_i].rows; row_i++) {
-      for (size_t col_j = 0; col_j < edge_images[img_i].cols; col_j++) {
-        if (edge_images[img_i].at<uint8_t>(row_i, col_j) != 255) {
-          continue;
-        }
-
-        candidate_row.push(row_i);
-        candidate_col.push(col_j);
-        candidate_img.push(img_i);
-        while (!candidate_col.empty()) {
-          int row = candidate_row.front();
-          int col = candidate_col.front();
-          int pic = candidate_img.front();
-          candidate_col.pop();
-          candidate_row.pop();
-          candidate_img.pop();
-
-          for (int i = -1; i <= 1; i++) {
-            for (int j = -1; j <= 1; j++) {
-              for (int k = -1; k <= 1; k++) {
-                int new_row = row + i;
-                int new_col = col + j;
-                int new_pic = pic + k;
-
-                // index out of range
-                if (new_col < 0 || new_row < 0 || new_pic < 1 ||
-                    new_col >= edge_images[0].cols ||
-                    new_row >= edge_images[0].rows ||
-                    new_pic >= edge_images.size() - 1) {
-                  continue;
-                }
-
-                if (edge_images[new_pic].at<uint8_t>(new_row, new_col) == 127) {
-                  edge_images[new_pic].at<uint8_t>(new_row, new_col) = 255;
-                  candidate_col.push(new_col);
-                  candidate_row.push(new_row);
-                  candidate_img.push(new_pic);
-                }
-              }
-            }
-          }
-        }
-      }
-    }
+  if (edge_images.size() < 3) return;
+
+  if (bricked_) {
+    BrickVolume<uint8_t> volume = BrickVolume<uint8_t>::FromSlices(edge_images);
+    TrackEdges(volume);
+    volume.ToSlices(edge_images);
+  } else {
+    SliceStack volume(edge_images);
+    TrackEdges(volume);
   }
-
-  for (size_t img_i = 1; img_i < edge_images.size() - 1; img_i++) {
-    for (size_t i = 0; i < edge_images[img_i].rows; i++) {
-      for (size_t j = 0; j < edge_images[img_i].cols; j++) {
-        if (edge_images[img_i].at<uint8_t>(i, j) != 255) {
-          edge_images[img_i].at<uint8_t>(i, j) = 0;
-        }
-      }
-    }
-  }
-}
\ No newline at end of file
+}
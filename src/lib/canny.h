@@ -2,9 +2,11 @@
 #define CANNY_H
 
 #include <blur.h>
+#include <brick.h>
 #include <opencv2/core/core_c.h>
 #include <sobel.h>
 
+#include <atomic>
 #include <opencv2/highgui.hpp>
 #include <opencv2/opencv.hpp>
 #include <queue>
@@ -19,6 +21,22 @@
  */
 class Canny3D {
  public:
+  /**
+   * @param verbose Печатать ли ход выполнения в std::cout
+   */
+  explicit Canny3D(bool verbose = true) : verbose_(verbose) {}
+
+  /**
+   * @brief Включает хранение объема кубами 8x8x8 при отслеживании границ
+   *
+   * Обход в ширину в EdgeTrackingByHysteresis постоянно переходит между
+   * соседними срезами; в разбиении на кубы @see BrickVolume эти соседи
+   * лежат рядом в памяти. Результат не меняется. Объемы, которые помещаются
+   * в кэш, так обрабатываются медленнее из-за перевода между представлениями,
+   * сравнение - в test/layout_benchmark.cpp.
+   */
+  void UseBrickedLayout(bool enable) { bricked_ = enable; }
+
   /**
    * @brief Трехмерный оператор Кэнни
    *
@@ -29,23 +47,96 @@ class Canny3D {
    * Собеля @see SobelOperator
    * @param blur_ksize Размер фильтра Гаусса, должен быть нечетным @see
    * GaussianBlur3D
+   * @param cancelled Флаг отмены, проверяется между этапами и перед каждым
+   * срезом внутри размытия, оператора Собеля и подавления немаксимумов. Если
+   * он установлен, промежуточные результаты освобождаются и возвращается
+   * пустой массив
    */
   std::vector<cv::Mat> DetectEdges(std::vector<cv::Mat>& images,
                                    int low_threshold = 50,
                                    int high_threshold = 150,
                                    double sobel_coef = 1e-5,
-                                   int blur_ksize = 5);
+                                   int blur_ksize = 5,
+                                   const std::atomic<bool>* cancelled = nullptr);
+
+  /**
+   * @brief Трехмерный оператор Кэнни с поиском от грубого к точному
+   *
+   * Сначала размытие, оператор Собеля и подавление немаксимумов выполняются на
+   * объеме, уменьшенном в 2 раза по каждой оси. Кандидатами в границы
+   * считаются воксели, значение которых после подавления немаксимумов не
+   * меньше половины нижнего порога. Затем размытие, оператор Собеля и
+   * подавление немаксимумов на исходном объеме выполняются только в
+   * окрестности кандидатов радиуса band_radius. Преобразования типов,
+   * приближение соседних срезов, пороговая фильтрация и отслеживание границ
+   * по-прежнему обрабатывают весь объем, поэтому режим не быстрее
+   * @see DetectEdges.
+   *
+   * @param images Изображения, на которых нужно найти границы
+   * @param low_threshold 	Нижний порог фильтрации
+   * @param high_threshold 	Верхний порог фильтрации
+   * @param sobel_coef Коэффициент приближения соседних срезов для оператора
+   * Собеля @see SobelOperator
+   * @param blur_ksize Размер фильтра Гаусса, должен быть нечетным @see
+   * GaussianBlur3D
+   * @param band_radius Радиус окрестности кандидатов в вокселях исходного
+   * объема
+   */
+  std::vector<cv::Mat> DetectEdgesCoarseToFine(std::vector<cv::Mat>& images,
+                                               int low_threshold = 50,
+                                               int high_threshold = 150,
+                                               double sobel_coef = 1e-5,
+                                               int blur_ksize = 5,
+                                               int band_radius = 2);
 
- private:
   /**
    * @brief Подавление немаксимумов вдоль направления градиента
    *
+   * Этап доступен отдельно, чтобы обрабатывать части объема
+   * @see IncrementalCanny3D
+   *
    * @param sop Оператор Собеля с посчитанными градиентами
+   * @param mask Маски CV_8UC1: вне маски значения градиента обнуляются. Если
+   * массив пустой, обрабатываются все пиксели
+   * @param cancelled Флаг отмены, проверяется перед каждым изображением
    *
-   * @return Массив карт градиентов после выполнения процедуры
+   * @return Массив карт градиентов после выполнения процедуры или пустой
+   * массив, если она отменена
    *
    */
-  std::vector<cv::Mat> NonMaximumSuppression(SobelOperator& sop);
+  std::vector<cv::Mat> NonMaximumSuppression(
+      SobelOperator& sop, const std::vector<cv::Mat>& mask = {},
+      const std::atomic<bool>* cancelled = nullptr);
+
+ private:
+  bool verbose_;
+  bool bricked_ = false;
+
+  void Log(const char* message) const;
+
+  /**
+   * @brief Находит окрестность кандидатов в граничные воксели
+   *
+   * Выполняет первые этапы алгоритма на уменьшенном объеме
+   * @see DetectEdgesCoarseToFine
+   *
+   * @return Маски CV_8UC1 для каждого изображения или пустой массив, если
+   * объем слишком мал для уменьшения
+   */
+  std::vector<cv::Mat> FindCandidateBand(std::vector<cv::Mat>& images,
+                                         int low_threshold, double sobel_coef,
+                                         int blur_ksize, int band_radius);
+
+  /**
+   * @brief Уменьшает объем в 2 раза по каждой оси
+   */
+  static std::vector<cv::Mat> Downsample(const std::vector<cv::Mat>& images);
+
+  /**
+   * @brief Расширяет маску на radius вокселей по каждой оси
+   */
+  static std::vector<cv::Mat> DilateMask(const std::vector<cv::Mat>& mask,
+                                         int radius);
 
   /**
    * @brief Двойная пороговая фильтрация
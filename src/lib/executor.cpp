@@ -0,0 +1,169 @@
+#include <executor.h>
+
+#include <algorithm>
+
+// Shared between the executor and its jobs, so that a job can still be
+// cancelled safely while the executor is being destroyed
+struct ExecutorState {
+  std::mutex mutex;
+  // signalled when a job is queued or the executor stops
+  std::condition_variable job_ready;
+  // signalled when a job releases its share of the limits
+  std::condition_variable budget_freed;
+  std::deque<std::shared_ptr<DetectionJob>> queue;
+
+  size_t max_in_flight = 0;
+  size_t memory_limit = 0;
+  size_t in_flight = 0;
+  size_t memory_used = 0;
+  bool stopping = false;
+
+  // has to be called with the mutex held
+  void Release(const DetectionJob& job) {
+    in_flight--;
+    memory_used -= job.memory_;
+    budget_freed.notify_all();
+  }
+};
+
+namespace {
+
+// Rough peak of the pipeline per voxel: double copies in the blur, five int32
+// slices read by the Sobel operator and its six int32 outputs
+const size_t kBytesPerVoxel = 64;
+
+void Finish(DetectionJob& job,
+            const std::function<void(DetectionJob&)>& callback) {
+  if (callback) callback(job);
+}
+
+}  // namespace
+
+void DetectionJob::Cancel() {
+  cancelled_ = true;
+  std::shared_ptr<ExecutorState> state = executor_.lock();
+  if (!state) return;
+
+  std::shared_ptr<DetectionJob> self;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    auto it = std::find_if(
+        state->queue.begin(), state->queue.end(),
+        [this](const std::shared_ptr<DetectionJob>& job) {
+          return job.get() == this;
+        });
+    // a running job is stopped by its worker after the current slice
+    if (it == state->queue.end()) return;
+    self = *it;
+    state->queue.erase(it);
+    images_.clear();
+    state->Release(*this);
+  }
+  promise_.set_exception(std::make_exception_ptr(DetectionCancelled()));
+  Finish(*this, callback_);
+}
+
+EdgeDetectionExecutor::EdgeDetectionExecutor(size_t threads,
+                                             size_t max_in_flight,
+                                             size_t memory_limit)
+    : state_(std::make_shared<ExecutorState>()) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  state_->max_in_flight = max_in_flight == 0 ? 2 * threads : max_in_flight;
+  state_->memory_limit = memory_limit;
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back(&EdgeDetectionExecutor::WorkerLoop, this);
+  }
+}
+
+EdgeDetectionExecutor::~EdgeDetectionExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stopping = true;
+  }
+  state_->job_ready.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::shared_ptr<DetectionJob> EdgeDetectionExecutor::Submit(
+    std::vector<cv::Mat> images, const DetectionParams& params,
+    Callback on_done) {
+  std::shared_ptr<DetectionJob> job = std::make_shared<DetectionJob>();
+  job->memory_ = EstimateMemory(images, params);
+  job->images_ = std::move(images);
+  job->params_ = params;
+  job->result_ = job->promise_.get_future();
+  job->callback_ = std::move(on_done);
+  job->executor_ = state_;
+
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  // back-pressure: wait until the job fits into the limits; a job larger than
+  // the whole memory budget is still accepted when nothing else is in flight
+  state_->budget_freed.wait(lock, [this, &job]() {
+    if (state_->in_flight >= state_->max_in_flight) return false;
+    return state_->memory_limit == 0 || state_->in_flight == 0 ||
+           state_->memory_used + job->memory_ <= state_->memory_limit;
+  });
+  state_->in_flight++;
+  state_->memory_used += job->memory_;
+  state_->queue.push_back(job);
+  lock.unlock();
+  state_->job_ready.notify_one();
+  return job;
+}
+
+size_t EdgeDetectionExecutor::EstimateMemory(
+    const std::vector<cv::Mat>& images, const DetectionParams& params) {
+  size_t input = 0;
+  size_t voxels = 0;
+  for (const cv::Mat& img : images) {
+    input += img.total() * img.elemSize();
+    voxels += img.total();
+  }
+  // the blur pads the stack with blur_ksize - 1 empty slices
+  if (!images.empty() && params.blur_ksize > 1) {
+    voxels += images[0].total() * (params.blur_ksize - 1);
+  }
+  return input + voxels * kBytesPerVoxel;
+}
+
+void EdgeDetectionExecutor::WorkerLoop() {
+  Canny3D canny(false);
+  while (true) {
+    std::shared_ptr<DetectionJob> job;
+    {
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      state_->job_ready.wait(lock, [this]() {
+        return state_->stopping || !state_->queue.empty();
+      });
+      if (state_->queue.empty()) return;
+      job = state_->queue.front();
+      state_->queue.pop_front();
+    }
+
+    try {
+      std::vector<cv::Mat> images = std::move(job->images_);
+      job->images_.clear();
+      std::vector<cv::Mat> edges = canny.DetectEdges(
+          images, job->params_.low_threshold, job->params_.high_threshold,
+          job->params_.sobel_coef, job->params_.blur_ksize, &job->cancelled_);
+      if (job->cancelled_) {
+        job->promise_.set_exception(
+            std::make_exception_ptr(DetectionCancelled()));
+      } else {
+        job->promise_.set_value(std::move(edges));
+      }
+    } catch (...) {
+      job->promise_.set_exception(std::current_exception());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      state_->Release(*job);
+    }
+    Finish(*job, job->callback_);
+  }
+}
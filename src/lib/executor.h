@@ -0,0 +1,137 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <canny.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Параметры обработки одного объема @see Canny3D::DetectEdges
+ */
+struct DetectionParams {
+  int low_threshold = 50;
+  int high_threshold = 150;
+  double sobel_coef = 1e-5;
+  int blur_ksize = 5;
+};
+
+/**
+ * @brief Исключение, которое получает future отмененной задачи
+ */
+class DetectionCancelled : public std::runtime_error {
+ public:
+  DetectionCancelled() : std::runtime_error("edge detection cancelled") {}
+};
+
+class EdgeDetectionExecutor;
+struct ExecutorState;
+
+/**
+ * @brief Задача поиска границ в одном объеме
+ *
+ * @class DetectionJob
+ * Создается методом EdgeDetectionExecutor::Submit
+ */
+class DetectionJob {
+ public:
+  /**
+   * @brief Результат обработки
+   *
+   * Если задача отменена, get() бросает DetectionCancelled
+   */
+  std::future<std::vector<cv::Mat>>& Result() { return result_; }
+
+  /**
+   * @brief Отменяет задачу
+   *
+   * Задача из очереди удаляется сразу вместе с исходными изображениями,
+   * выполняющаяся задача останавливается после обработки текущего среза.
+   */
+  void Cancel();
+
+  bool IsCancelled() const { return cancelled_; }
+
+ private:
+  friend class EdgeDetectionExecutor;
+  friend struct ExecutorState;
+
+  std::vector<cv::Mat> images_;
+  DetectionParams params_;
+  // estimated peak memory, reserved from the executor's budget
+  size_t memory_ = 0;
+  std::atomic<bool> cancelled_{false};
+  std::promise<std::vector<cv::Mat>> promise_;
+  std::future<std::vector<cv::Mat>> result_;
+  std::function<void(DetectionJob&)> callback_;
+  std::weak_ptr<ExecutorState> executor_;
+};
+
+/**
+ * @brief Асинхронная обработка нескольких объемов
+ *
+ * @class EdgeDetectionExecutor
+ * Общий пул потоков, который обрабатывает поданные объемы. Число принятых
+ * задач и их суммарная оценка памяти ограничены: Submit блокируется, пока
+ * ограничение не позволит принять новый объем.
+ */
+class EdgeDetectionExecutor {
+ public:
+  typedef std::function<void(DetectionJob&)> Callback;
+
+  /**
+   * @param threads Число рабочих потоков, 0 - по числу ядер
+   * @param max_in_flight Максимальное число принятых (ожидающих и
+   * выполняющихся) задач, 0 - вдвое больше числа потоков
+   * @param memory_limit Ограничение суммарной оценки памяти задач в байтах,
+   * 0 - без ограничения
+   */
+  explicit EdgeDetectionExecutor(size_t threads = 0, size_t max_in_flight = 0,
+                                 size_t memory_limit = 0);
+
+  /**
+   * @brief Дожидается выполнения всех принятых задач
+   */
+  ~EdgeDetectionExecutor();
+
+  EdgeDetectionExecutor(const EdgeDetectionExecutor&) = delete;
+  EdgeDetectionExecutor& operator=(const EdgeDetectionExecutor&) = delete;
+
+  /**
+   * @brief Ставит объем в очередь
+   *
+   * @param images Срезы объема
+   * @param params Параметры детектора
+   * @param on_done Вызывается после завершения или отмены задачи, результат
+   * доступен через DetectionJob::Result()
+   *
+   * @return Задача
+   */
+  std::shared_ptr<DetectionJob> Submit(std::vector<cv::Mat> images,
+                                       const DetectionParams& params = {},
+                                       Callback on_done = nullptr);
+
+  /**
+   * @brief Оценка пиковой памяти при обработке объема
+   *
+   * @return Размер в байтах
+   */
+  static size_t EstimateMemory(const std::vector<cv::Mat>& images,
+                               const DetectionParams& params);
+
+ private:
+  std::shared_ptr<ExecutorState> state_;
+  std::vector<std::thread> workers_;
+
+  void WorkerLoop();
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef HYSTERESIS_H
+#define HYSTERESIS_H
+
+#include <opencv2/core/core_c.h>
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <queue>
+#include <vector>
+
+/**
+ * @brief Массив срезов с доступом к вокселям как у BrickVolume
+ *
+ * @class SliceStack
+ * Не копирует срезы, все изменения видны в исходном массиве
+ */
+class SliceStack {
+ public:
+  explicit SliceStack(std::vector<cv::Mat>& images) : images_(images) {}
+
+  uint8_t& at(int z, int y, int x) { return images_[z].at<uint8_t>(y, x); }
+
+  int depth() const { return images_.size(); }
+  int rows() const { return images_[0].rows; }
+  int cols() const { return images_[0].cols; }
+
+  /**
+   * @brief Обходит воксели по срезам, затем по строкам
+   *
+   * @param f Вызывается как f(z, y, x, value) для каждого вокселя
+   */
+  template <class F>
+  void ForEach(F f) {
+    for (int z = 0; z < depth(); z++) {
+      for (int y = 0; y < rows(); y++) {
+        for (int x = 0; x < cols(); x++) {
+          f(z, y, x, at(z, y, x));
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<cv::Mat>& images_;
+};
+
+/**
+ * @brief Обход в ширину 26-связной компоненты
+ *
+ * Первый и последний срезы объема в компоненты не входят, как и в
+ * Canny3D::DetectEdges.
+ *
+ * @param volume Объем с методами depth(), rows() и cols() @see SliceStack
+ * @see BrickVolume
+ * @param seed Первый воксель компоненты (x, y, z), уже помеченный вызывающим
+ * @param candidates Пустая очередь обхода. Ее передает вызывающий, чтобы
+ * память выделялась один раз на весь объем, а не на каждую компоненту; после
+ * обхода очередь снова пуста
+ * @param enter Вызывается как enter(z, y, x) для соседей посещенных вокселей
+ * и возвращает true, если воксель входит в компоненту и еще не посещен. Сама
+ * функция помечает воксель как посещенный
+ * @param visit Вызывается как visit(z, y, x) для каждого вокселя компоненты
+ */
+template <class Volume, class Enter, class Visit>
+void TraceComponent(const Volume& volume, cv::Point3i seed,
+                    std::queue<cv::Point3i>& candidates, Enter enter,
+                    Visit visit) {
+  const int last_img = volume.depth() - 1;
+  candidates.push(seed);
+  while (!candidates.empty()) {
+    cv::Point3i p = candidates.front();
+    candidates.pop();
+    visit(p.z, p.y, p.x);
+
+    for (int i = -1; i <= 1; i++) {
+      for (int j = -1; j <= 1; j++) {
+        for (int k = -1; k <= 1; k++) {
+          int new_row = p.y + i;
+          int new_col = p.x + j;
+          int new_pic = p.z + k;
+
+          // index out of range
+          if (new_col < 0 || new_row < 0 || new_pic < 1 ||
+              new_col >= volume.cols() || new_row >= volume.rows() ||
+              new_pic >= last_img) {
+            continue;
+          }
+
+          if (enter(new_pic, new_row, new_col)) {
+            candidates.push(cv::Point3i(new_col, new_row, new_pic));
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Отслеживание границ на объеме после двойной пороговой фильтрации
+ *
+ * Кандидаты (127), связные с граничными вокселями (255), становятся
+ * граничными, остальные обнуляются. Первый и последний срезы не меняются.
+ *
+ * @param volume Объем вокселей uint8_t @see SliceStack @see BrickVolume
+ */
+template <class Volume>
+void TrackEdges(Volume& volume) {
+  const int last_img = volume.depth() - 1;
+  auto enter = [&volume](int z, int y, int x) {
+    uint8_t& value = volume.at(z, y, x);
+    if (value != 127) return false;
+    value = 255;
+    return true;
+  };
+  auto visit = [](int, int, int) {};
+  std::queue<cv::Point3i> candidates;
+
+  // voxels marked during a trace are seeds again later, their neighbours are
+  // all marked already, so these traces stop at once
+  volume.ForEach([&](int img_i, int row_i, int col_j, uint8_t& value) {
+    if (img_i < 1 || img_i >= last_img || value != 255) {
+      return;
+    }
+    TraceComponent(volume, cv::Point3i(col_j, row_i, img_i), candidates, enter,
+                   visit);
+  });
+
+  volume.ForEach([last_img](int img_i, int, int, uint8_t& value) {
+    if (img_i >= 1 && img_i < last_img && value != 255) {
+      value = 0;
+    }
+  });
+}
+
+#endif
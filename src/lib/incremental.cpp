@@ -0,0 +1,147 @@
+#include <hysteresis.h>
+#include <incremental.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+IncrementalCanny3D::IncrementalCanny3D(int low_threshold, int high_threshold,
+                                       double sobel_coef, int blur_ksize)
+    : low_threshold_(low_threshold),
+      high_threshold_(high_threshold),
+      sobel_coef_(sobel_coef),
+      blur_ksize_(blur_ksize),
+      canny_(false) {}
+
+const std::vector<cv::Mat>& IncrementalCanny3D::ReplaceSlices(
+    size_t first, const std::vector<cv::Mat>& slices) {
+  if (first > images_.size()) {
+    throw std::out_of_range("first replaced slice is past the end of volume");
+  }
+  if (slices.empty()) return edges_;
+
+  size_t size = std::max(images_.size(), first + slices.size());
+  images_.resize(size);
+  blurred_.resize(size);
+  suppressed_.resize(size);
+  states_.resize(size);
+  edges_.resize(size);
+  std::copy(slices.begin(), slices.end(), images_.begin() + first);
+
+  Update(first, first + slices.size() - 1);
+  return edges_;
+}
+
+const std::vector<cv::Mat>& IncrementalCanny3D::AppendSlices(
+    const std::vector<cv::Mat>& slices) {
+  return ReplaceSlices(images_.size(), slices);
+}
+
+void IncrementalCanny3D::Update(int first, int last) {
+  const int last_img = images_.size() - 1;
+  const int r = blur_ksize_ / 2;
+  auto clip_low = [](int i) { return std::max(0, i); };
+  auto clip_high = [last_img](int i) { return std::min(last_img, i); };
+
+  // Gaussian filter reaches r images away
+  int blur_first = clip_low(first - r);
+  int blur_last = clip_high(last + r);
+  {
+    int from = clip_low(blur_first - r);
+    std::vector<cv::Mat> images(images_.begin() + from,
+                                images_.begin() + clip_high(blur_last + r) + 1);
+    std::vector<cv::Mat> blurred = GaussianBlur3D(images).Blur(blur_ksize_);
+    for (int img_i = blur_first; img_i <= blur_last; img_i++) {
+      blurred_[img_i] = blurred[img_i - from];
+    }
+  }
+
+  // Sobel operator and its interpolation reach one image away; non-maximum
+  // suppression uses only gradients of the same image
+  int nms_first = clip_low(blur_first - 1);
+  int nms_last = clip_high(blur_last + 1);
+  {
+    int from = clip_low(nms_first - 1);
+    std::vector<cv::Mat> blurred(blurred_.begin() + from,
+                                 blurred_.begin() + clip_high(nms_last + 1) + 1);
+    SobelOperator sop(blurred, sobel_coef_);
+    std::vector<cv::Mat> suppressed = canny_.NonMaximumSuppression(sop);
+    for (int img_i = nms_first; img_i <= nms_last; img_i++) {
+      suppressed_[img_i] = suppressed[img_i - from];
+    }
+  }
+
+  // like DetectEdges, the first and the last images are not thresholded
+  const Kernels& kernels = ActiveKernels();
+  for (int img_i = nms_first; img_i <= nms_last; img_i++) {
+    if (img_i == 0 || img_i == last_img) {
+      // no component reaches these images
+      states_[img_i] = cv::Mat::zeros(suppressed_[img_i].size(), CV_8UC1);
+      edges_[img_i] = suppressed_[img_i].clone();
+      continue;
+    }
+    states_[img_i] = suppressed_[img_i].clone();
+    for (int i = 0; i < states_[img_i].rows; i++) {
+      kernels.threshold_row(states_[img_i].ptr<uint8_t>(i), low_threshold_,
+                            high_threshold_, 0, states_[img_i].cols);
+    }
+    edges_[img_i] = cv::Mat::zeros(states_[img_i].size(), CV_8UC1);
+  }
+
+  TrackEdges(nms_first - 1, nms_last + 1);
+}
+
+void IncrementalCanny3D::TrackEdges(int first, int last) {
+  const int last_img = images_.size() - 1;
+  first = std::max(first, 1);
+  last = std::min(last, last_img - 1);
+  if (first > last) return;
+
+  // Every path from an unchanged component into the recomputed images passes
+  // through images first or last, so components seeded there are all the
+  // components that may have changed. Visited masks are allocated only for
+  // the images a component actually reaches.
+  std::vector<cv::Mat> visited(images_.size());
+  auto visit = [&](int pic, int row, int col) {
+    if (visited[pic].empty()) {
+      visited[pic] = cv::Mat::zeros(states_[pic].size(), CV_8UC1);
+    }
+    uint8_t& mark = visited[pic].at<uint8_t>(row, col);
+    bool first_visit = mark == 0;
+    mark = 1;
+    return first_visit;
+  };
+
+  SliceStack volume(states_);
+  auto enter = [&](int pic, int row, int col) {
+    return states_[pic].at<uint8_t>(row, col) != 0 && visit(pic, row, col);
+  };
+  std::queue<cv::Point3i> candidates;
+  std::vector<cv::Point3i> component;
+  bool strong = false;
+  auto collect = [&](int pic, int row, int col) {
+    component.push_back(cv::Point3i(col, row, pic));
+    strong = strong || states_[pic].at<uint8_t>(row, col) == 255;
+  };
+
+  for (int img_i = first; img_i <= last; img_i++) {
+    for (int row_i = 0; row_i < states_[img_i].rows; row_i++) {
+      for (int col_j = 0; col_j < states_[img_i].cols; col_j++) {
+        if (states_[img_i].at<uint8_t>(row_i, col_j) == 0 ||
+            !visit(img_i, row_i, col_j)) {
+          continue;
+        }
+
+        // collecting the whole component of weak and strong pixels
+        component.clear();
+        strong = false;
+        TraceComponent(volume, cv::Point3i(col_j, row_i, img_i), candidates,
+                       enter, collect);
+
+        // the component is an edge if it contains a strong pixel
+        for (const cv::Point3i& p : component) {
+          edges_[p.z].at<uint8_t>(p.y, p.x) = strong ? 255 : 0;
+        }
+      }
+    }
+  }
+}
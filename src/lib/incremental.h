@@ -0,0 +1,90 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <canny.h>
+
+#include <vector>
+
+/**
+ * @brief Трехмерный оператор Кэнни для постепенно меняющегося объема
+ *
+ * @class IncrementalCanny3D
+ * Хранит результаты всех этапов предыдущего запуска. При замене или
+ * добавлении срезов размытие, оператор Собеля и подавление немаксимумов
+ * пересчитываются только для срезов, чья окрестность по оси Z задевает
+ * изменение, а отслеживание границ - только для связных компонент,
+ * касающихся пересчитанных срезов. Результат совпадает с результатом
+ * Canny3D::DetectEdges на всем объеме.
+ */
+class IncrementalCanny3D {
+ public:
+  /**
+   * @param low_threshold 	Нижний порог фильтрации
+   * @param high_threshold 	Верхний порог фильтрации
+   * @param sobel_coef Коэффициент приближения соседних срезов для оператора
+   * Собеля @see SobelOperator
+   * @param blur_ksize Размер фильтра Гаусса, должен быть нечетным @see
+   * GaussianBlur3D
+   */
+  explicit IncrementalCanny3D(int low_threshold = 50, int high_threshold = 150,
+                              double sobel_coef = 1e-5, int blur_ksize = 5);
+
+  /**
+   * @brief Заменяет срезы, начиная с first
+   *
+   * Срезы, выходящие за конец объема, добавляются к нему.
+   *
+   * @param first Номер первого заменяемого среза, не больше числа срезов
+   * @param slices Новые срезы того же размера, что и остальные
+   *
+   * @return Границы для всего объема @see Edges
+   *
+   * @throws std::out_of_range Если first больше числа срезов
+   */
+  const std::vector<cv::Mat>& ReplaceSlices(size_t first,
+                                            const std::vector<cv::Mat>& slices);
+
+  /**
+   * @brief Добавляет срезы в конец объема
+   *
+   * @return Границы для всего объема @see Edges
+   */
+  const std::vector<cv::Mat>& AppendSlices(const std::vector<cv::Mat>& slices);
+
+  /**
+   * @brief Границы, найденные для текущего объема
+   */
+  const std::vector<cv::Mat>& Edges() const { return edges_; }
+
+  size_t size() const { return images_.size(); }
+
+ private:
+  int low_threshold_;
+  int high_threshold_;
+  double sobel_coef_;
+  int blur_ksize_;
+  Canny3D canny_;
+
+  // stage results for every slice
+  std::vector<cv::Mat> images_;
+  std::vector<cv::Mat> blurred_;
+  // after non-maximum suppression
+  std::vector<cv::Mat> suppressed_;
+  // after double thresholding: 0, 127 or 255; zeros in the first and the last
+  // images
+  std::vector<cv::Mat> states_;
+  std::vector<cv::Mat> edges_;
+
+  /**
+   * @brief Пересчитывает этапы после изменения срезов [first, last]
+   */
+  void Update(int first, int last);
+
+  /**
+   * @brief Отслеживание границ для компонент, касающихся срезов
+   * [first, last]
+   */
+  void TrackEdges(int first, int last);
+};
+
+#endif
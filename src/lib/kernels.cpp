@@ -0,0 +1,199 @@
+#include <kernels.h>
+#include <kernels_impl.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace kernels_impl {
+
+void ScalarBlurRow(const double* const* rows, const double* filter, int ksize,
+                   double* dst, int from, int to) {
+  const int r = ksize / 2;
+  for (int j = from; j < to; j++) {
+    double value = 0;
+    for (int row = 0; row < ksize * ksize; row++) {
+      const double* src = rows[row] + j - r;
+      const double* coef = filter + row * ksize;
+      for (int k = 0; k < ksize; k++) {
+        value += src[k] * coef[k];
+      }
+    }
+    dst[j] = value;
+  }
+}
+
+void ScalarSobelRow(const int32_t* const* rows, int32_t* magnitude,
+                    int32_t* gx, int32_t* gy, int32_t* gz, int from, int to) {
+  // weights of the Sobel-Feldman filters along each axis
+  static const int kSmooth[3] = {1, 2, 1};
+  for (int j = from; j < to; j++) {
+    int Gx = 0;
+    int Gy = 0;
+    int Gz = 0;
+    for (int p = 0; p < 3; p++) {
+      for (int r = 0; r < 3; r++) {
+        const int32_t* src = rows[p * 3 + r] + j;
+        Gx += kSmooth[p] * kSmooth[r] * (src[-1] - src[1]);
+        if (r != 1) {
+          Gy += kSmooth[p] * (r == 0 ? 1 : -1) *
+                (src[-1] + 2 * src[0] + src[1]);
+        }
+        if (p != 1) {
+          Gz += kSmooth[r] * (p == 0 ? 1 : -1) *
+                (src[-1] + 2 * src[0] + src[1]);
+        }
+      }
+    }
+
+    // counting the gradient magnitude
+    magnitude[j] = (int32_t)(sqrt((double)Gx * Gx + (double)Gy * Gy +
+                                  (double)Gz * Gz));
+    if (gx) gx[j] = Gx;
+    if (gy) gy[j] = Gy;
+    if (gz) gz[j] = Gz;
+  }
+}
+
+void ScalarQuantizeDirectionRow(const int32_t* gx, const int32_t* gy,
+                                const int32_t* gz, int32_t* dir_x,
+                                int32_t* dir_y, int32_t* dir_z, int from,
+                                int to) {
+  for (int j = from; j < to; j++) {
+    const double Gx = gx[j];
+    const double Gy = gy[j];
+    const double Gz = gz[j];
+    dir_x[j] = 0;
+    dir_y[j] = 0;
+    dir_z[j] = 0;
+
+    // calculating the gradient's direction
+    // in means of pixels
+    double best_cos = 0;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+          if (dx == 0 && dy == 0 && dz == 0) continue;
+          double dot_product = dx * Gx + dy * Gy + dz * Gz;
+          double norm =
+              sqrt(dx * dx + dy * dy + dz * dz) * sqrt(Gx * Gx + Gy * Gy + Gz * Gz);
+          if (std::abs(dot_product / norm) > best_cos) {  // closer to 1
+            best_cos = std::abs(dot_product / norm);
+            dir_x[j] = dx;
+            dir_y[j] = dy;
+            dir_z[j] = dz;
+          }
+        }
+      }
+    }
+  }
+}
+
+void ScalarNmsRow(const int32_t* grad, const int32_t* dir_x,
+                  const int32_t* dir_y, const int32_t* dir_z,
+                  const int32_t* const* first_rows,
+                  const int32_t* const* second_rows, int32_t* dst, int from,
+                  int to) {
+  for (int j = from; j < to; j++) {
+    int dx = dir_x[j];
+    int dy = dir_y[j];
+    if (dir_z[j] == 1) {
+      dx = -dx;
+      dy = -dy;
+    }
+    int32_t value = grad[j];
+    if (value < first_rows[1 + dy][j + dx] ||
+        value < second_rows[1 - dy][j - dx]) {
+      value = 0;
+    }
+    dst[j] = value;
+  }
+}
+
+void ScalarThresholdRow(uint8_t* row, int low_threshold, int high_threshold,
+                        int from, int to) {
+  for (int j = from; j < to; j++) {
+    int value = row[j];
+
+    if (value > high_threshold) {
+      row[j] = 255;
+    } else if (value < low_threshold) {
+      row[j] = 0;
+    } else {
+      row[j] = 127;
+    }
+  }
+}
+
+}  // namespace kernels_impl
+
+namespace {
+
+const Kernels kScalarKernels = {
+    kernels_impl::ScalarBlurRow,
+    kernels_impl::ScalarSobelRow,
+    kernels_impl::ScalarQuantizeDirectionRow,
+    kernels_impl::ScalarNmsRow,
+    kernels_impl::ScalarThresholdRow,
+    "scalar"};
+
+bool CpuSupports(const std::string& name) {
+  if (name == "scalar") return true;
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (name == "sse4") return __builtin_cpu_supports("sse4.1");
+  if (name == "avx2") return __builtin_cpu_supports("avx2");
+  if (name == "avx512") {
+    return __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw");
+  }
+#endif
+  return false;
+}
+
+const Kernels* CompiledKernels(const std::string& name) {
+  if (name == "scalar") return &kScalarKernels;
+  if (name == "sse4") return kernels_impl::Sse4Kernels();
+  if (name == "avx2") return kernels_impl::Avx2Kernels();
+  if (name == "avx512") return kernels_impl::Avx512Kernels();
+  return nullptr;
+}
+
+const Kernels& SelectKernels() {
+  const char* forced = std::getenv("CANNY3D_KERNELS");
+  if (forced != nullptr && *forced != '\0') {
+    const Kernels* kernels = FindKernels(forced);
+    if (kernels != nullptr) return *kernels;
+    std::cerr << "CANNY3D_KERNELS=" << forced
+              << " is not supported on this machine, detecting automatically"
+              << std::endl;
+  }
+  // the fastest variant goes last
+  return *AvailableKernels().back();
+}
+
+}  // namespace
+
+const Kernels& ActiveKernels() {
+  static const Kernels& kernels = SelectKernels();
+  return kernels;
+}
+
+const Kernels& ScalarKernels() { return kScalarKernels; }
+
+std::vector<const Kernels*> AvailableKernels() {
+  std::vector<const Kernels*> result;
+  for (const char* name : {"scalar", "sse4", "avx2", "avx512"}) {
+    const Kernels* kernels = FindKernels(name);
+    if (kernels != nullptr) result.push_back(kernels);
+  }
+  return result;
+}
+
+const Kernels* FindKernels(const std::string& name) {
+  // the accessors of the vectorized variants are built for their instruction
+  // set, so they may be called only on a CPU that supports it
+  if (!CpuSupports(name)) return nullptr;
+  return CompiledKernels(name);
+}
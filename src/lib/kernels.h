@@ -0,0 +1,130 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Набор вычислительных ядер для одной строки изображения
+ *
+ * @struct Kernels
+ * Содержит эталонную скалярную реализацию или ее векторизованный вариант
+ * (SSE4, AVX2, AVX-512) для всех горячих циклов детектора. Все варианты
+ * обрабатывают столбцы [from, to) одной строки и дают тот же результат, что и
+ * скалярная реализация.
+ */
+struct Kernels {
+  /**
+   * @brief Размытие строки трехмерным фильтром Гаусса
+   *
+   * @param rows ksize * ksize указателей на строки окрестности, сначала по
+   * срезам, затем по строкам среза
+   * @param filter Фильтр размера ksize^3 в порядке [срез][строка][столбец]
+   * @param ksize Размер фильтра
+   * @param dst Строка результата
+   */
+  void (*blur_row)(const double* const* rows, const double* filter, int ksize,
+                   double* dst, int from, int to);
+
+  /**
+   * @brief Оператор Собеля-Фельдмана для строки
+   *
+   * @param rows 9 указателей на строки окрестности: строки i-1, i, i+1
+   * предыдущего, текущего и следующего срезов
+   * @param magnitude Строка значений градиента
+   * @param gx, gy, gz Составляющие градиента, могут быть nullptr
+   */
+  void (*sobel_row)(const int32_t* const* rows, int32_t* magnitude,
+                    int32_t* gx, int32_t* gy, int32_t* gz, int from, int to);
+
+  /**
+   * @brief Приводит направление градиента к одному из 26 соседей
+   *
+   * Значения dir_x, dir_y, dir_z лежат в { -1, 0, 1 } @see SobelOperator
+   */
+  void (*quantize_direction_row)(const int32_t* gx, const int32_t* gy,
+                                 const int32_t* gz, int32_t* dir_x,
+                                 int32_t* dir_y, int32_t* dir_z, int from,
+                                 int to);
+
+  /**
+   * @brief Подавление немаксимумов для строки
+   *
+   * @param grad Строка значений градиента
+   * @param first_rows Строки i-1, i, i+1 градиентов приближенного предыдущего
+   * среза
+   * @param second_rows Строки i-1, i, i+1 градиентов приближенного следующего
+   * среза
+   * @param dst Строка результата, может совпадать с grad
+   */
+  void (*nms_row)(const int32_t* grad, const int32_t* dir_x,
+                  const int32_t* dir_y, const int32_t* dir_z,
+                  const int32_t* const* first_rows,
+                  const int32_t* const* second_rows, int32_t* dst, int from,
+                  int to);
+
+  /**
+   * @brief Двойная пороговая фильтрация строки на месте
+   *
+   * Значения больше верхнего порога становятся 255, меньше нижнего - 0,
+   * остальные - 127
+   */
+  void (*threshold_row)(uint8_t* row, int low_threshold, int high_threshold,
+                        int from, int to);
+
+  // variant name: "scalar", "sse4", "avx2" or "avx512"
+  const char* name;
+};
+
+/**
+ * @brief Ядра, выбранные при запуске
+ *
+ * Выбирается самый быстрый вариант, поддерживаемый процессором. Переменная
+ * окружения CANNY3D_KERNELS (scalar, sse4, avx2, avx512) позволяет выбрать
+ * вариант вручную.
+ *
+ * @return Выбранный набор ядер
+ */
+const Kernels& ActiveKernels();
+
+/**
+ * @brief Эталонная скалярная реализация ядер
+ */
+const Kernels& ScalarKernels();
+
+/**
+ * @brief Все варианты ядер, которые можно запустить на этом процессоре
+ *
+ * @return Массив вариантов, первым идет скалярный
+ */
+std::vector<const Kernels*> AvailableKernels();
+
+/**
+ * @brief Ищет вариант ядер по имени
+ *
+ * @param name Имя варианта
+ *
+ * @return Набор ядер или nullptr, если вариант не поддерживается
+ */
+const Kernels* FindKernels(const std::string& name);
+
+/**
+ * @brief Перебирает отрезки строки маски с ненулевыми значениями
+ *
+ * Для каждого непрерывного отрезка [begin, end) внутри [from, to), где маска
+ * ненулевая, вызывает f(begin, end). Позволяет применять ядра только к части
+ * строки.
+ */
+template <class F>
+void ForEachMaskRun(const uint8_t* mask, int from, int to, F f) {
+  int j = from;
+  while (j < to) {
+    while (j < to && !mask[j]) j++;
+    int begin = j;
+    while (j < to && mask[j]) j++;
+    if (begin < j) f(begin, j);
+  }
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include <kernels_impl.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2 {
+  static const int kDoubles = 4;
+  static const int kInts = 8;
+  static const int kBytes = 32;
+
+  typedef __m256d VD;
+  typedef __m256d MD;
+  typedef __m256i VI;
+  typedef __m256i MI;
+  typedef __m256i VB;
+  typedef __m256i MB;
+
+  static VD LoadD(const double* p) { return _mm256_loadu_pd(p); }
+  static void StoreD(double* p, VD v) { _mm256_storeu_pd(p, v); }
+  static VD LoadI32D(const int32_t* p) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)p));
+  }
+  static void StoreI32D(int32_t* p, VD v) {
+    _mm_storeu_si128((__m128i*)p, _mm256_cvttpd_epi32(v));
+  }
+  static VD Set1D(double v) { return _mm256_set1_pd(v); }
+  static VD AddD(VD a, VD b) { return _mm256_add_pd(a, b); }
+  static VD SubD(VD a, VD b) { return _mm256_sub_pd(a, b); }
+  static VD MulD(VD a, VD b) { return _mm256_mul_pd(a, b); }
+  static VD DivD(VD a, VD b) { return _mm256_div_pd(a, b); }
+  static VD SqrtD(VD v) { return _mm256_sqrt_pd(v); }
+  static VD AbsD(VD v) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v); }
+  static MD GreaterD(VD a, VD b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static VD SelectD(MD m, VD a, VD b) { return _mm256_blendv_pd(b, a, m); }
+
+  static VI LoadI(const int32_t* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+  }
+  static void StoreI(int32_t* p, VI v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static VI Set1I(int v) { return _mm256_set1_epi32(v); }
+  static VI SubI(VI a, VI b) { return _mm256_sub_epi32(a, b); }
+  static MI EqualI(VI a, VI b) { return _mm256_cmpeq_epi32(a, b); }
+  static MI GreaterI(VI a, VI b) { return _mm256_cmpgt_epi32(a, b); }
+  static MI AndM(MI a, MI b) { return _mm256_and_si256(a, b); }
+  static MI OrM(MI a, MI b) { return _mm256_or_si256(a, b); }
+  static VI SelectI(MI m, VI a, VI b) { return _mm256_blendv_epi8(b, a, m); }
+
+  static VB LoadB(const uint8_t* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+  }
+  static void StoreB(uint8_t* p, VB v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static VB Set1B(int v) { return _mm256_set1_epi8((char)v); }
+  static MB GreaterEqualB(VB a, VB b) {
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+  }
+  static MB LessEqualB(VB a, VB b) {
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+  }
+  static MB NoneB() { return _mm256_setzero_si256(); }
+  static MB AllB() { return _mm256_set1_epi8(-1); }
+  static VB SelectB(MB m, VB a, VB b) { return _mm256_blendv_epi8(b, a, m); }
+};
+
+// constant-initialized, so no code built for this instruction set runs
+// before the CPU is checked
+const Kernels kAvx2Kernels = {
+    kernels_impl::BlurRow<Avx2>,
+    kernels_impl::SobelRow<Avx2>,
+    kernels_impl::QuantizeDirectionRow<Avx2>,
+    kernels_impl::NmsRow<Avx2>,
+    kernels_impl::ThresholdRow<Avx2>,
+    "avx2"};
+
+}  // namespace
+
+const Kernels* kernels_impl::Avx2Kernels() { return &kAvx2Kernels; }
+
+#else
+
+const Kernels* kernels_impl::Avx2Kernels() { return nullptr; }
+
+#endif
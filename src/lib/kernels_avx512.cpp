@@ -0,0 +1,76 @@
+#include <kernels_impl.h>
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512 {
+  static const int kDoubles = 8;
+  static const int kInts = 16;
+  static const int kBytes = 64;
+
+  typedef __m512d VD;
+  typedef __mmask8 MD;
+  typedef __m512i VI;
+  typedef __mmask16 MI;
+  typedef __m512i VB;
+  typedef __mmask64 MB;
+
+  static VD LoadD(const double* p) { return _mm512_loadu_pd(p); }
+  static void StoreD(double* p, VD v) { _mm512_storeu_pd(p, v); }
+  static VD LoadI32D(const int32_t* p) {
+    return _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i*)p));
+  }
+  static void StoreI32D(int32_t* p, VD v) {
+    _mm256_storeu_si256((__m256i*)p, _mm512_cvttpd_epi32(v));
+  }
+  static VD Set1D(double v) { return _mm512_set1_pd(v); }
+  static VD AddD(VD a, VD b) { return _mm512_add_pd(a, b); }
+  static VD SubD(VD a, VD b) { return _mm512_sub_pd(a, b); }
+  static VD MulD(VD a, VD b) { return _mm512_mul_pd(a, b); }
+  static VD DivD(VD a, VD b) { return _mm512_div_pd(a, b); }
+  static VD SqrtD(VD v) { return _mm512_sqrt_pd(v); }
+  static VD AbsD(VD v) { return _mm512_abs_pd(v); }
+  static MD GreaterD(VD a, VD b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+  static VD SelectD(MD m, VD a, VD b) { return _mm512_mask_blend_pd(m, b, a); }
+
+  static VI LoadI(const int32_t* p) { return _mm512_loadu_si512(p); }
+  static void StoreI(int32_t* p, VI v) { _mm512_storeu_si512(p, v); }
+  static VI Set1I(int v) { return _mm512_set1_epi32(v); }
+  static VI SubI(VI a, VI b) { return _mm512_sub_epi32(a, b); }
+  static MI EqualI(VI a, VI b) { return _mm512_cmpeq_epi32_mask(a, b); }
+  static MI GreaterI(VI a, VI b) { return _mm512_cmpgt_epi32_mask(a, b); }
+  static MI AndM(MI a, MI b) { return a & b; }
+  static MI OrM(MI a, MI b) { return a | b; }
+  static VI SelectI(MI m, VI a, VI b) { return _mm512_mask_blend_epi32(m, b, a); }
+
+  static VB LoadB(const uint8_t* p) { return _mm512_loadu_si512(p); }
+  static void StoreB(uint8_t* p, VB v) { _mm512_storeu_si512(p, v); }
+  static VB Set1B(int v) { return _mm512_set1_epi8((char)v); }
+  static MB GreaterEqualB(VB a, VB b) { return _mm512_cmpge_epu8_mask(a, b); }
+  static MB LessEqualB(VB a, VB b) { return _mm512_cmple_epu8_mask(a, b); }
+  static MB NoneB() { return 0; }
+  static MB AllB() { return ~(MB)0; }
+  static VB SelectB(MB m, VB a, VB b) { return _mm512_mask_blend_epi8(m, b, a); }
+};
+
+// constant-initialized, so no code built for this instruction set runs
+// before the CPU is checked
+const Kernels kAvx512Kernels = {
+    kernels_impl::BlurRow<Avx512>,
+    kernels_impl::SobelRow<Avx512>,
+    kernels_impl::QuantizeDirectionRow<Avx512>,
+    kernels_impl::NmsRow<Avx512>,
+    kernels_impl::ThresholdRow<Avx512>,
+    "avx512"};
+
+}  // namespace
+
+const Kernels* kernels_impl::Avx512Kernels() { return &kAvx512Kernels; }
+
+#else
+
+const Kernels* kernels_impl::Avx512Kernels() { return nullptr; }
+
+#endif
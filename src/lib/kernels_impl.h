@@ -0,0 +1,236 @@
+#ifndef KERNELS_IMPL_H
+#define KERNELS_IMPL_H
+
+#include <kernels.h>
+
+#include <cmath>
+#include <cstdint>
+
+// Internal header: scalar reference kernels and the generic vectorized
+// kernels, instantiated once per instruction set in kernels_<isa>.cpp.
+//
+// A vector traits type V provides:
+//   V::kDoubles, V::kInts, V::kBytes   - lanes per vector
+//   VD, MD   - double vector and its mask
+//   VI, MI   - int32 vector and its mask
+//   VB, MB   - uint8 vector and its mask
+// and the static operations used below. Double lanes are used for blur, Sobel
+// and direction quantization: all intermediate values of the Sobel operator
+// are integers well below 2^53, so double arithmetic is exact there and
+// matches the scalar reference bit for bit. Kernel files are compiled with
+// -ffp-contract=off, so the blur sum is evaluated in the same order and with
+// the same rounding as the reference.
+
+namespace kernels_impl {
+
+void ScalarBlurRow(const double* const* rows, const double* filter, int ksize,
+                   double* dst, int from, int to);
+void ScalarSobelRow(const int32_t* const* rows, int32_t* magnitude,
+                    int32_t* gx, int32_t* gy, int32_t* gz, int from, int to);
+void ScalarQuantizeDirectionRow(const int32_t* gx, const int32_t* gy,
+                                const int32_t* gz, int32_t* dir_x,
+                                int32_t* dir_y, int32_t* dir_z, int from,
+                                int to);
+void ScalarNmsRow(const int32_t* grad, const int32_t* dir_x,
+                  const int32_t* dir_y, const int32_t* dir_z,
+                  const int32_t* const* first_rows,
+                  const int32_t* const* second_rows, int32_t* dst, int from,
+                  int to);
+void ScalarThresholdRow(uint8_t* row, int low_threshold, int high_threshold,
+                        int from, int to);
+
+// Variants compiled for other instruction sets, nullptr if the compiler
+// could not build them
+const Kernels* Sse4Kernels();
+const Kernels* Avx2Kernels();
+const Kernels* Avx512Kernels();
+
+template <class V>
+void BlurRow(const double* const* rows, const double* filter, int ksize,
+             double* dst, int from, int to) {
+  const int r = ksize / 2;
+  int j = from;
+  for (; j + V::kDoubles <= to; j += V::kDoubles) {
+    typename V::VD value = V::Set1D(0.0);
+    for (int row = 0; row < ksize * ksize; row++) {
+      const double* src = rows[row] + j - r;
+      const double* coef = filter + row * ksize;
+      for (int k = 0; k < ksize; k++) {
+        value = V::AddD(value, V::MulD(V::LoadD(src + k), V::Set1D(coef[k])));
+      }
+    }
+    V::StoreD(dst + j, value);
+  }
+  ScalarBlurRow(rows, filter, ksize, dst, j, to);
+}
+
+template <class V>
+void SobelRow(const int32_t* const* rows, int32_t* magnitude, int32_t* gx,
+              int32_t* gy, int32_t* gz, int from, int to) {
+  typedef typename V::VD VD;
+  const VD two = V::Set1D(2.0);
+  int j = from;
+  for (; j + V::kDoubles <= to; j += V::kDoubles) {
+    // weighted sums of the 3x3 neighbourhood of every plane:
+    // dx - left minus right column, dy - upper minus lower row,
+    // s - the whole neighbourhood with weights 1 2 1 along both axes
+    VD plane_dx[3];
+    VD plane_dy[3];
+    VD plane_s[3];
+    for (int p = 0; p < 3; p++) {
+      const int32_t* up = rows[p * 3] + j;
+      const int32_t* mid = rows[p * 3 + 1] + j;
+      const int32_t* low = rows[p * 3 + 2] + j;
+      VD col_l = V::AddD(V::AddD(V::LoadI32D(up - 1), V::LoadI32D(low - 1)),
+                         V::MulD(two, V::LoadI32D(mid - 1)));
+      VD col_c = V::AddD(V::AddD(V::LoadI32D(up), V::LoadI32D(low)),
+                         V::MulD(two, V::LoadI32D(mid)));
+      VD col_r = V::AddD(V::AddD(V::LoadI32D(up + 1), V::LoadI32D(low + 1)),
+                         V::MulD(two, V::LoadI32D(mid + 1)));
+      VD row_u = V::AddD(V::AddD(V::LoadI32D(up - 1), V::LoadI32D(up + 1)),
+                         V::MulD(two, V::LoadI32D(up)));
+      VD row_d = V::AddD(V::AddD(V::LoadI32D(low - 1), V::LoadI32D(low + 1)),
+                         V::MulD(two, V::LoadI32D(low)));
+      plane_dx[p] = V::SubD(col_l, col_r);
+      plane_dy[p] = V::SubD(row_u, row_d);
+      plane_s[p] = V::AddD(V::AddD(col_l, col_r), V::MulD(two, col_c));
+    }
+    VD Gx = V::AddD(V::AddD(plane_dx[0], plane_dx[2]),
+                    V::MulD(two, plane_dx[1]));
+    VD Gy = V::AddD(V::AddD(plane_dy[0], plane_dy[2]),
+                    V::MulD(two, plane_dy[1]));
+    VD Gz = V::SubD(plane_s[0], plane_s[2]);
+
+    VD norm2 = V::AddD(V::AddD(V::MulD(Gx, Gx), V::MulD(Gy, Gy)),
+                       V::MulD(Gz, Gz));
+    V::StoreI32D(magnitude + j, V::SqrtD(norm2));
+    if (gx) V::StoreI32D(gx + j, Gx);
+    if (gy) V::StoreI32D(gy + j, Gy);
+    if (gz) V::StoreI32D(gz + j, Gz);
+  }
+  ScalarSobelRow(rows, magnitude, gx, gy, gz, j, to);
+}
+
+template <class V>
+void QuantizeDirectionRow(const int32_t* gx, const int32_t* gy,
+                          const int32_t* gz, int32_t* dir_x, int32_t* dir_y,
+                          int32_t* dir_z, int from, int to) {
+  typedef typename V::VD VD;
+  typedef typename V::MD MD;
+  // The reference scans all 26 neighbours and keeps the first one with a
+  // strictly larger |cos|. A direction and its opposite have equal |cos|, so
+  // only the one met first is ever kept: it suffices to scan the 13
+  // directions whose first non-zero component is -1, in the same order.
+  static const int kDirs[13][3] = {
+      {-1, -1, -1}, {-1, -1, 0}, {-1, -1, 1}, {-1, 0, -1}, {-1, 0, 0},
+      {-1, 0, 1},   {-1, 1, -1}, {-1, 1, 0},  {-1, 1, 1},  {0, -1, -1},
+      {0, -1, 0},   {0, -1, 1},  {0, 0, -1}};
+  const double kLength[4] = {0.0, std::sqrt(1.0), std::sqrt(2.0),
+                             std::sqrt(3.0)};
+  const VD zero = V::Set1D(0.0);
+  int j = from;
+  for (; j + V::kDoubles <= to; j += V::kDoubles) {
+    VD Gx = V::LoadI32D(gx + j);
+    VD Gy = V::LoadI32D(gy + j);
+    VD Gz = V::LoadI32D(gz + j);
+    VD grad_norm = V::SqrtD(V::AddD(V::AddD(V::MulD(Gx, Gx), V::MulD(Gy, Gy)),
+                                    V::MulD(Gz, Gz)));
+    VD best_cos = zero;
+    VD best_x = zero;
+    VD best_y = zero;
+    VD best_z = zero;
+    for (int d = 0; d < 13; d++) {
+      const int dx = kDirs[d][0];
+      const int dy = kDirs[d][1];
+      const int dz = kDirs[d][2];
+      VD dot = zero;
+      if (dx) dot = dx > 0 ? V::AddD(dot, Gx) : V::SubD(dot, Gx);
+      if (dy) dot = dy > 0 ? V::AddD(dot, Gy) : V::SubD(dot, Gy);
+      if (dz) dot = dz > 0 ? V::AddD(dot, Gz) : V::SubD(dot, Gz);
+      VD norm =
+          V::MulD(V::Set1D(kLength[dx * dx + dy * dy + dz * dz]), grad_norm);
+      VD cos = V::AbsD(V::DivD(dot, norm));
+      MD closer = V::GreaterD(cos, best_cos);
+      best_cos = V::SelectD(closer, cos, best_cos);
+      best_x = V::SelectD(closer, V::Set1D(dx), best_x);
+      best_y = V::SelectD(closer, V::Set1D(dy), best_y);
+      best_z = V::SelectD(closer, V::Set1D(dz), best_z);
+    }
+    V::StoreI32D(dir_x + j, best_x);
+    V::StoreI32D(dir_y + j, best_y);
+    V::StoreI32D(dir_z + j, best_z);
+  }
+  ScalarQuantizeDirectionRow(gx, gy, gz, dir_x, dir_y, dir_z, j, to);
+}
+
+template <class V>
+void NmsRow(const int32_t* grad, const int32_t* dir_x, const int32_t* dir_y,
+            const int32_t* dir_z, const int32_t* const* first_rows,
+            const int32_t* const* second_rows, int32_t* dst, int from,
+            int to) {
+  typedef typename V::VI VI;
+  typedef typename V::MI MI;
+  const VI zero = V::Set1I(0);
+  const VI one = V::Set1I(1);
+  int j = from;
+  for (; j + V::kInts <= to; j += V::kInts) {
+    VI g = V::LoadI(grad + j);
+    VI dx = V::LoadI(dir_x + j);
+    VI dy = V::LoadI(dir_y + j);
+    MI flip = V::EqualI(V::LoadI(dir_z + j), one);
+    dx = V::SelectI(flip, V::SubI(zero, dx), dx);
+    dy = V::SelectI(flip, V::SubI(zero, dy), dy);
+
+    // gather the neighbours (i + dy, j + dx) and (i - dy, j - dx) by
+    // selecting among the 9 possible offsets
+    VI first = zero;
+    VI second = zero;
+    for (int oy = -1; oy <= 1; oy++) {
+      MI row_match = V::EqualI(dy, V::Set1I(oy));
+      for (int ox = -1; ox <= 1; ox++) {
+        MI match = V::AndM(row_match, V::EqualI(dx, V::Set1I(ox)));
+        first = V::SelectI(match, V::LoadI(first_rows[1 + oy] + j + ox), first);
+        second =
+            V::SelectI(match, V::LoadI(second_rows[1 - oy] + j - ox), second);
+      }
+    }
+    MI suppress = V::OrM(V::GreaterI(first, g), V::GreaterI(second, g));
+    V::StoreI(dst + j, V::SelectI(suppress, zero, g));
+  }
+  ScalarNmsRow(grad, dir_x, dir_y, dir_z, first_rows, second_rows, dst, j, to);
+}
+
+template <class V>
+void ThresholdRow(uint8_t* row, int low_threshold, int high_threshold,
+                  int from, int to) {
+  typedef typename V::VB VB;
+  typedef typename V::MB MB;
+  const VB strong = V::Set1B(255);
+  const VB weak = V::Set1B(127);
+  const VB none = V::Set1B(0);
+  // value > high <=> value >= high + 1, value < low <=> value <= low - 1;
+  // thresholds outside of [0, 255] make the comparison constant
+  const bool high_never = high_threshold >= 255;
+  const bool high_always = high_threshold < 0;
+  const bool low_never = low_threshold <= 0;
+  const bool low_always = low_threshold > 255;
+  const VB high = V::Set1B(high_never || high_always ? 0 : high_threshold + 1);
+  const VB low = V::Set1B(low_never || low_always ? 0 : low_threshold - 1);
+  int j = from;
+  for (; j + V::kBytes <= to; j += V::kBytes) {
+    VB value = V::LoadB(row + j);
+    MB is_strong = high_never    ? V::NoneB()
+                   : high_always ? V::AllB()
+                                 : V::GreaterEqualB(value, high);
+    MB is_none = low_never    ? V::NoneB()
+                 : low_always ? V::AllB()
+                              : V::LessEqualB(value, low);
+    VB result = V::SelectB(is_none, none, weak);
+    V::StoreB(row + j, V::SelectB(is_strong, strong, result));
+  }
+  ScalarThresholdRow(row, low_threshold, high_threshold, j, to);
+}
+
+}  // namespace kernels_impl
+
+#endif
@@ -0,0 +1,80 @@
+#include <kernels_impl.h>
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+
+namespace {
+
+struct Sse4 {
+  static const int kDoubles = 2;
+  static const int kInts = 4;
+  static const int kBytes = 16;
+
+  typedef __m128d VD;
+  typedef __m128d MD;
+  typedef __m128i VI;
+  typedef __m128i MI;
+  typedef __m128i VB;
+  typedef __m128i MB;
+
+  static VD LoadD(const double* p) { return _mm_loadu_pd(p); }
+  static void StoreD(double* p, VD v) { _mm_storeu_pd(p, v); }
+  static VD LoadI32D(const int32_t* p) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)p));
+  }
+  static void StoreI32D(int32_t* p, VD v) {
+    _mm_storel_epi64((__m128i*)p, _mm_cvttpd_epi32(v));
+  }
+  static VD Set1D(double v) { return _mm_set1_pd(v); }
+  static VD AddD(VD a, VD b) { return _mm_add_pd(a, b); }
+  static VD SubD(VD a, VD b) { return _mm_sub_pd(a, b); }
+  static VD MulD(VD a, VD b) { return _mm_mul_pd(a, b); }
+  static VD DivD(VD a, VD b) { return _mm_div_pd(a, b); }
+  static VD SqrtD(VD v) { return _mm_sqrt_pd(v); }
+  static VD AbsD(VD v) { return _mm_andnot_pd(_mm_set1_pd(-0.0), v); }
+  static MD GreaterD(VD a, VD b) { return _mm_cmpgt_pd(a, b); }
+  static VD SelectD(MD m, VD a, VD b) { return _mm_blendv_pd(b, a, m); }
+
+  static VI LoadI(const int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static void StoreI(int32_t* p, VI v) { _mm_storeu_si128((__m128i*)p, v); }
+  static VI Set1I(int v) { return _mm_set1_epi32(v); }
+  static VI SubI(VI a, VI b) { return _mm_sub_epi32(a, b); }
+  static MI EqualI(VI a, VI b) { return _mm_cmpeq_epi32(a, b); }
+  static MI GreaterI(VI a, VI b) { return _mm_cmpgt_epi32(a, b); }
+  static MI AndM(MI a, MI b) { return _mm_and_si128(a, b); }
+  static MI OrM(MI a, MI b) { return _mm_or_si128(a, b); }
+  static VI SelectI(MI m, VI a, VI b) { return _mm_blendv_epi8(b, a, m); }
+
+  static VB LoadB(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static void StoreB(uint8_t* p, VB v) { _mm_storeu_si128((__m128i*)p, v); }
+  static VB Set1B(int v) { return _mm_set1_epi8((char)v); }
+  static MB GreaterEqualB(VB a, VB b) {
+    return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a);
+  }
+  static MB LessEqualB(VB a, VB b) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a);
+  }
+  static MB NoneB() { return _mm_setzero_si128(); }
+  static MB AllB() { return _mm_set1_epi8(-1); }
+  static VB SelectB(MB m, VB a, VB b) { return _mm_blendv_epi8(b, a, m); }
+};
+
+// constant-initialized, so no code built for this instruction set runs
+// before the CPU is checked
+const Kernels kSse4Kernels = {
+    kernels_impl::BlurRow<Sse4>,
+    kernels_impl::SobelRow<Sse4>,
+    kernels_impl::QuantizeDirectionRow<Sse4>,
+    kernels_impl::NmsRow<Sse4>,
+    kernels_impl::ThresholdRow<Sse4>,
+    "sse4"};
+
+}  // namespace
+
+const Kernels* kernels_impl::Sse4Kernels() { return &kSse4Kernels; }
+
+#else
+
+const Kernels* kernels_impl::Sse4Kernels() { return nullptr; }
+
+#endif
@@ -1,7 +1,9 @@
 #include <sobel.h>
 
-SobelOperator::SobelOperator(std::vector<cv::Mat>& images, double coef)
-    : images_(images) {
+SobelOperator::SobelOperator(std::vector<cv::Mat>& images, double coef,
+                             const std::vector<cv::Mat>& mask,
+                             const std::atomic<bool>* cancelled)
+    : images_(images), mask_(mask), cancelled_(cancelled) {
   for (cv::Mat img : images_) {
     gradient_.push_back(cv::Mat::zeros(img.size(), CV_32SC1));
     interpolated_gradient_.push_back(
@@ -45,107 +47,76 @@ SobelOperator::SobelOperator(std::vector<cv::Mat>& images, double coef)
 }
 
 void SobelOperator::Count() {
-  SobelFeldmanFilters filter = SobelFeldmanFilters();
+  const Kernels& kernels = ActiveKernels();
 
   for (size_t img_i = 0; img_i < images_.size(); img_i++) {
+    if (cancelled_ != nullptr && *cancelled_) break;
+
     // while proccessing current image (img) also consider the previous and
     // the next ones, but with interpolation
-    cv::Mat img = images_[img_i];
-    cv::Mat prev_img = interpolated_images_[img_i][1];
-    cv::Mat next_img = interpolated_images_[img_i][2];
-    cv::Mat prev_prev_img = interpolated_images_[img_i][0];
-    cv::Mat next_next_img = interpolated_images_[img_i][3];
-
-    for (size_t i = 1; i < img.rows - 1; i++) {
-      for (size_t j = 1; j < img.cols - 1; j++) {
-        cv::Mat part = img(cv::Rect(j - 1, i - 1, 3, 3));
-        cv::Mat prev_part = prev_img(cv::Rect(j - 1, i - 1, 3, 3));
-        cv::Mat next_part = next_img(cv::Rect(j - 1, i - 1, 3, 3));
-        part.convertTo(part, CV_32SC1);
-        prev_part.convertTo(prev_part, CV_32SC1);
-        next_part.convertTo(next_part, CV_32SC1);
-
-        // counting gradients along directions
-        int Gx = cv::sum(prev_part.mul(filter.xdir.kernel1)).val[0] +
-                 cv::sum(part.mul(filter.xdir.kernel2)).val[0] +
-                 cv::sum(next_part.mul(filter.xdir.kernel3)).val[0];
-        int Gy = cv::sum(prev_part.mul(filter.ydir.kernel1)).val[0] +
-                 cv::sum(part.mul(filter.ydir.kernel2)).val[0] +
-                 cv::sum(next_part.mul(filter.ydir.kernel3)).val[0];
-        int Gz = cv::sum(prev_part.mul(filter.zdir.kernel1)).val[0] +
-                 cv::sum(part.mul(filter.zdir.kernel2)).val[0] +
-                 cv::sum(next_part.mul(filter.zdir.kernel3)).val[0];
+    cv::Mat img;
+    cv::Mat prev_img;
+    cv::Mat next_img;
+    cv::Mat prev_prev_img;
+    cv::Mat next_next_img;
+    images_[img_i].convertTo(img, CV_32SC1);
+    interpolated_images_[img_i][1].convertTo(prev_img, CV_32SC1);
+    interpolated_images_[img_i][2].convertTo(next_img, CV_32SC1);
+    interpolated_images_[img_i][0].convertTo(prev_prev_img, CV_32SC1);
+    interpolated_images_[img_i][3].convertTo(next_next_img, CV_32SC1);
 
-        // counting the gradient magnitude
-        gradient_[img_i].at<int32_t>(i, j) =
-            (int32_t)(sqrt(Gx * Gx + Gy * Gy + Gz * Gz));
+    // gradient components of the current row
+    std::vector<int32_t> Gx(img.cols);
+    std::vector<int32_t> Gy(img.cols);
+    std::vector<int32_t> Gz(img.cols);
+    const int32_t* rows[9];
+    for (int i = 1; i < img.rows - 1; i++) {
+      auto count_run = [&](int from, int to) {
+        for (int row = 0; row < 3; row++) {
+          rows[row] = prev_img.ptr<int32_t>(i - 1 + row);
+          rows[3 + row] = img.ptr<int32_t>(i - 1 + row);
+          rows[6 + row] = next_img.ptr<int32_t>(i - 1 + row);
+        }
+        kernels.sobel_row(rows, gradient_[img_i].ptr<int32_t>(i), Gx.data(),
+                          Gy.data(), Gz.data(), from, to);
 
         // calculating the gradient's direction
         // in means of pixels
-        double best_cos = 0;
-        for (int dx = -1; dx <= 1; dx++) {
-          for (int dy = -1; dy <= 1; dy++) {
-            for (int dz = -1; dz <= 1; dz++) {
-              if (dx == 0 && dy == 0 && dz == 0) continue;
-              double dot_product = dx * Gx + dy * Gy + dz * Gz;
-              double norm = sqrt(dx * dx + dy * dy + dz * dz) *
-                            sqrt(Gx * Gx + Gy * Gy + Gz * Gz);
-              if (std::abs(dot_product / norm) > best_cos) {  // closer to 1
-                best_cos = std::abs(dot_product / norm);
-                grad_dir_x_[img_i].at<int32_t>(i, j) = dx;
-                grad_dir_y_[img_i].at<int32_t>(i, j) = dy;
-                grad_dir_z_[img_i].at<int32_t>(i, j) = dz;
-              }
-            }
-          }
-        }
+        kernels.quantize_direction_row(
+            Gx.data(), Gy.data(), Gz.data(),
+            grad_dir_x_[img_i].ptr<int32_t>(i),
+            grad_dir_y_[img_i].ptr<int32_t>(i),
+            grad_dir_z_[img_i].ptr<int32_t>(i), from, to);
 
         // counting gradients for prev
-        part = prev_img(cv::Rect(j - 1, i - 1, 3, 3));
-        prev_part = prev_prev_img(cv::Rect(j - 1, i - 1, 3, 3));
-        next_part = img(cv::Rect(j - 1, i - 1, 3, 3));
-        part.convertTo(part, CV_32SC1);
-        prev_part.convertTo(prev_part, CV_32SC1);
-        next_part.convertTo(next_part, CV_32SC1);
-
-        Gx = cv::sum(prev_part.mul(filter.xdir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.xdir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.xdir.kernel3)).val[0];
-        Gy = cv::sum(prev_part.mul(filter.ydir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.ydir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.ydir.kernel3)).val[0];
-        Gz = cv::sum(prev_part.mul(filter.zdir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.zdir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.zdir.kernel3)).val[0];
-
-        // counting the gradient magnitude
-        interpolated_gradient_[img_i].first.at<int32_t>(i, j) =
-            (int32_t)(sqrt(Gx * Gx + Gy * Gy + Gz * Gz));
+        for (int row = 0; row < 3; row++) {
+          rows[row] = prev_prev_img.ptr<int32_t>(i - 1 + row);
+          rows[3 + row] = prev_img.ptr<int32_t>(i - 1 + row);
+          rows[6 + row] = img.ptr<int32_t>(i - 1 + row);
+        }
+        kernels.sobel_row(rows,
+                          interpolated_gradient_[img_i].first.ptr<int32_t>(i),
+                          nullptr, nullptr, nullptr, from, to);
 
         // counting gradients for next
-        part = next_img(cv::Rect(j - 1, i - 1, 3, 3));
-        prev_part = img(cv::Rect(j - 1, i - 1, 3, 3));
-        next_part = next_next_img(cv::Rect(j - 1, i - 1, 3, 3));
-        part.convertTo(part, CV_32SC1);
-        prev_part.convertTo(prev_part, CV_32SC1);
-        next_part.convertTo(next_part, CV_32SC1);
-
-        Gx = cv::sum(prev_part.mul(filter.xdir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.xdir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.xdir.kernel3)).val[0];
-        Gy = cv::sum(prev_part.mul(filter.ydir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.ydir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.ydir.kernel3)).val[0];
-        Gz = cv::sum(prev_part.mul(filter.zdir.kernel1)).val[0] +
-             cv::sum(part.mul(filter.zdir.kernel2)).val[0] +
-             cv::sum(next_part.mul(filter.zdir.kernel3)).val[0];
+        for (int row = 0; row < 3; row++) {
+          rows[row] = img.ptr<int32_t>(i - 1 + row);
+          rows[3 + row] = next_img.ptr<int32_t>(i - 1 + row);
+          rows[6 + row] = next_next_img.ptr<int32_t>(i - 1 + row);
+        }
+        kernels.sobel_row(rows,
+                          interpolated_gradient_[img_i].second.ptr<int32_t>(i),
+                          nullptr, nullptr, nullptr, from, to);
+      };
 
-        // counting the gradient magnitude
-        interpolated_gradient_[img_i].second.at<int32_t>(i, j) =
-            (int32_t)(sqrt(Gx * Gx + Gy * Gy + Gz * Gz));
+      if (mask_.empty()) {
+        count_run(1, img.cols - 1);
+      } else {
+        ForEachMaskRun(mask_[img_i].ptr<uint8_t>(i), 1, img.cols - 1,
+                       count_run);
       }
     }
   }
 
   counted_ = true;
-}
\ No newline at end of file
+}
@@ -1,69 +1,21 @@
 #ifndef SOBEL_H
 #define SOBEL_H
 
+#include <kernels.h>
 #include <opencv2/core/core_c.h>
 
+#include <atomic>
 #include <opencv2/highgui.hpp>
 #include <opencv2/opencv.hpp>
 #include <vector>
 
-/**
- * @brief Трехмерные фильтры Собеля-Фельдмана
- *
- * @struct SobelFeldmanFilters
- * Содержит фильтры для всех направлений
- */
-struct SobelFeldmanFilters {
-  SobelFeldmanFilters() {
-    zdir.kernel1.convertTo(zdir.kernel1, CV_32SC1);
-    zdir.kernel2.convertTo(zdir.kernel2, CV_32SC1);
-    zdir.kernel3.convertTo(zdir.kernel3, CV_32SC1);
-    xdir.kernel1.convertTo(xdir.kernel1, CV_32SC1);
-    xdir.kernel2.convertTo(xdir.kernel2, CV_32SC1);
-    xdir.kernel3.convertTo(xdir.kernel3, CV_32SC1);
-    ydir.kernel1.convertTo(ydir.kernel1, CV_32SC1);
-    ydir.kernel2.convertTo(ydir.kernel2, CV_32SC1);
-    ydir.kernel3.convertTo(ydir.kernel3, CV_32SC1);
-  }
-  struct ZDirection {
-    ZDirection() = default;
-    const cv::Mat kernel1 = (cv::Mat_<int>(3, 3) << 1, 2, 1, 2, 4, 2, 1, 2, 1);
-    const cv::Mat kernel2 = (cv::Mat_<int>(3, 3) << 0, 0, 0, 0, 0, 0, 0, 0, 0);
-    const cv::Mat kernel3 =
-        (cv::Mat_<int>(3, 3) << -1, -2, -1, -2, -4, -2, -1, -2, -1);
-  };
-  struct XDirection {
-    // positive in the "right" direction
-    XDirection() = default;
-    const cv::Mat kernel1 =
-        (cv::Mat_<int>(3, 3) << 1, 0, -1, 2, 0, -2, 1, 0, -1);
-    const cv::Mat kernel2 =
-        (cv::Mat_<int>(3, 3) << 2, 0, -2, 4, 0, -4, 2, 0, -2);
-    const cv::Mat kernel3 =
-        (cv::Mat_<int>(3, 3) << 1, 0, -1, 2, 0, -2, 1, 0, -1);
-  };
-  struct YDirection {
-    // positive in the "down" direction
-    YDirection() = default;
-    const cv::Mat kernel1 =
-        (cv::Mat_<int>(3, 3) << 1, 2, 1, 0, 0, 0, -1, -2, -1);
-    const cv::Mat kernel2 =
-        (cv::Mat_<int>(3, 3) << 2, 4, 2, 0, 0, 0, -2, -4, -2);
-    const cv::Mat kernel3 =
-        (cv::Mat_<int>(3, 3) << 1, 2, 1, 0, 0, 0, -1, -2, -1);
-  };
-
-  ZDirection zdir;
-  XDirection xdir;
-  YDirection ydir;
-};
-
 /**
  * @brief Трехмерный оператор Собеля
  *
  * @class SobelOperator
  * Считает градиенты и их направление вдоль 3х осей,
- * также считает градиенты для приближенных соседних срезов
+ * также считает градиенты для приближенных соседних срезов.
+ * Фильтры Собеля-Фельдмана применяются построчно @see Kernels::sobel_row
  *
  */
 class SobelOperator {
@@ -73,8 +25,15 @@ class SobelOperator {
    *
    * @param images Обрабатываемые изображения
    * @param coef Коэффициент приближения соседних срезов
+   * @param mask Маски CV_8UC1 для каждого изображения: градиенты считаются
+   * только в пикселях с ненулевым значением маски, в остальных они равны 0.
+   * Если массив пустой, градиенты считаются во всех пикселях
+   * @param cancelled Флаг отмены, проверяется перед каждым изображением.
+   * После отмены оставшиеся градиенты равны 0
    */
-  SobelOperator(std::vector<cv::Mat>& images, double coef = 1e-5);
+  SobelOperator(std::vector<cv::Mat>& images, double coef = 1e-5,
+                const std::vector<cv::Mat>& mask = {},
+                const std::atomic<bool>* cancelled = nullptr);
 
   /**
    * @brief Геттер для градиентов
@@ -151,6 +110,8 @@ class SobelOperator {
   bool counted_ = false;
 
   std::vector<cv::Mat> images_;
+  std::vector<cv::Mat> mask_;
+  const std::atomic<bool>* cancelled_;
   std::vector<std::vector<cv::Mat>> interpolated_images_;  // of size 4
   std::vector<cv::Mat> gradient_;
   std::vector<std::pair<cv::Mat, cv::Mat>> interpolated_gradient_;
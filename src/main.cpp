@@ -4,7 +4,17 @@
 #include <string>
 #include <vector>
 
-int main() {
+int main(int argc, char** argv) {
+  // "--coarse-to-fine" runs the multi-resolution mode and prefixes the output
+  // files with "c2f_", so that both results can be compared by eval;
+  // "--bricked" tracks edges on the 8x8x8 brick layout
+  bool coarse_to_fine = false;
+  bool bricked = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--coarse-to-fine") coarse_to_fine = true;
+    if (std::string(argv[i]) == "--bricked") bricked = true;
+  }
+
   // reading preproccesssed images
   std::cout << "Reading images" << std::endl;
   std::vector<cv::Mat> images;
@@ -16,9 +26,13 @@ int main() {
   std::cout << "Images read" << std::endl;
 
   Canny3D canny;
-  std::vector<cv::Mat> edges = canny.DetectEdges(images, 40, 180, 1);
+  canny.UseBrickedLayout(bricked);
+  std::vector<cv::Mat> edges =
+      coarse_to_fine ? canny.DetectEdgesCoarseToFine(images, 40, 180, 1)
+                     : canny.DetectEdges(images, 40, 180, 1);
 
+  std::string prefix = coarse_to_fine ? "c2f_" : "";
   for (size_t i = 0; i < edges.size(); i++) {
-    cv::imwrite(std::to_string(i) + ".png", edges[i]);
+    cv::imwrite(prefix + std::to_string(i) + ".png", edges[i]);
   }
 }
@@ -0,0 +1,65 @@
+#include <canny.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "evaluation.h"
+#include "test_util.h"
+#include "test_volume.h"
+
+// Compares DetectEdgesCoarseToFine with DetectEdges on every slice, the full
+// resolution result acting as the ideal image
+
+namespace {
+
+// mean errors over the thresholded slices may not exceed this
+const double kMaxMeanError = 0.02;
+
+}  // namespace
+
+int main() {
+  double false_negative_sum = 0;
+  double false_positive_sum = 0;
+  int counted = 0;
+  for (unsigned seed = 1; seed <= 4; seed++) {
+    std::vector<cv::Mat> images = RandomVolume(20, 80, 80, seed);
+    Canny3D canny(false);
+    std::vector<cv::Mat> ideal = canny.DetectEdges(images, 40, 180, 1);
+    std::vector<cv::Mat> result =
+        canny.DetectEdgesCoarseToFine(images, 40, 180, 1);
+    Check(result.size() == ideal.size(), "number of slices");
+    if (result.size() != ideal.size()) continue;
+
+    // the first and the last slices keep the gradient of the whole slice
+    Check(Equal(result.front(), ideal.front()), "first slice");
+    Check(Equal(result.back(), ideal.back()), "last slice");
+
+    std::cout << "Volume " << seed << ":";
+    for (size_t img_i = 0; img_i < result.size(); img_i++) {
+      std::pair<double, double> errors =
+          CountErrors(result[img_i], ideal[img_i]);
+      std::cout << " " << errors.first << "/" << errors.second;
+      // the first and the last slices hold the gradient rather than edges,
+      // its mid-range values count as missed edges even in equal slices;
+      // NaN when neither slice has edges
+      bool edge_slice = img_i > 0 && img_i + 1 < result.size();
+      if (edge_slice && !std::isnan(errors.first)) {
+        false_negative_sum += errors.first;
+        false_positive_sum += errors.second;
+        ++counted;
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  double false_negative = counted ? false_negative_sum / counted : 0;
+  double false_positive = counted ? false_positive_sum / counted : 0;
+  std::cout << "Mean errors: " << false_negative << " " << false_positive
+            << std::endl;
+  Check(false_negative <= kMaxMeanError, "mean type I error");
+  Check(false_positive <= kMaxMeanError, "mean type II error");
+
+  return TestResult("coarse_to_fine_test");
+}
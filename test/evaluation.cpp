@@ -1,62 +1,38 @@
-#include <cassert>
-#include <cstdint>
+#include <cmath>
 #include <iostream>
 #include <opencv2/highgui.hpp>
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
 
-// Counts probability of type I and type II errors
-std::pair<double, double> CountErrors(cv::Mat result, cv::Mat ideal) {
-  assert(result.cols == ideal.cols && result.rows == ideal.rows);
-
-  cv::Mat ideal_8u;
-  cv::Mat result_8u;
-  ideal.convertTo(ideal_8u, CV_8UC1);
-  result.convertTo(result_8u, CV_8UC1);
-
-  int false_negative = 0;
-  int false_positive = 0;
-  int ideal_edge_num = 0;
-  int result_edge_num = 0;
-  for (size_t i = 0; i < ideal_8u.rows; i++) {
-    for (size_t j = 0; j < ideal_8u.cols; j++) {
-      if (ideal_8u.at<uint8_t>(i, j) > 100 &&
-          result_8u.at<uint8_t>(i, j) < 200) {
-        // is an edge pixel but wasn't detected
-        ++false_negative;
-      }
-      if (ideal_8u.at<uint8_t>(i, j) < 100 &&
-          result_8u.at<uint8_t>(i, j) > 200) {
-        // is not an edge pixel but is detected
-        ++false_positive;
-      }
-      if (ideal_8u.at<uint8_t>(i, j) > 100) {
-        ++ideal_edge_num;
-      }
-      if (result_8u.at<uint8_t>(i, j) > 200) {
-        ++result_edge_num;
-      }
-    }
-  }
-
-  int edge_num = std::max(result_edge_num, ideal_edge_num);
-
-  return std::make_pair((double)false_negative / edge_num,
-                        (double)false_positive / edge_num);
-}
+#include "evaluation.h"
 
+// Reads pairs of paths until the end of input, so that a whole volume can be
+// compared slice by slice, and prints the mean over the slices with edges
 int main() {
-  std::cout << "Enter path to the result image\n";
+  std::cout << "Enter paths to the result image and to image with ideal "
+               "edges, one pair per slice\n";
   std::string path_result;
-  std::cin >> path_result;
-  std::cout << "Enter path to image with ideal edges\n";
   std::string path_ideal;
-  std::cin >> path_ideal;
-
-  cv::Mat result = cv::imread(path_result, cv::IMREAD_UNCHANGED);
-  cv::Mat ideal = cv::imread(path_ideal, cv::IMREAD_GRAYSCALE);
-  std::pair<double, double> errors = CountErrors(result, ideal);
+  double false_negative_sum = 0;
+  double false_positive_sum = 0;
+  int counted = 0;
+  while (std::cin >> path_result >> path_ideal) {
+    cv::Mat result = cv::imread(path_result, cv::IMREAD_UNCHANGED);
+    cv::Mat ideal = cv::imread(path_ideal, cv::IMREAD_GRAYSCALE);
+    std::pair<double, double> errors = CountErrors(result, ideal);
+
+    std::cout << errors.first << " " << errors.second << std::endl;
+    // NaN when neither image has edges
+    if (!std::isnan(errors.first)) {
+      false_negative_sum += errors.first;
+      false_positive_sum += errors.second;
+      ++counted;
+    }
+  }
 
-  std::cout << errors.first << " " << errors.second << std::endl;
-}
\ No newline at end of file
+  if (counted > 1) {
+    std::cout << "mean: " << false_negative_sum / counted << " "
+              << false_positive_sum / counted << std::endl;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <utility>
+
+// Counts probability of type I and type II errors
+inline std::pair<double, double> CountErrors(cv::Mat result, cv::Mat ideal) {
+  assert(result.cols == ideal.cols && result.rows == ideal.rows);
+
+  cv::Mat ideal_8u;
+  cv::Mat result_8u;
+  ideal.convertTo(ideal_8u, CV_8UC1);
+  result.convertTo(result_8u, CV_8UC1);
+
+  int false_negative = 0;
+  int false_positive = 0;
+  int ideal_edge_num = 0;
+  int result_edge_num = 0;
+  for (size_t i = 0; i < ideal_8u.rows; i++) {
+    for (size_t j = 0; j < ideal_8u.cols; j++) {
+      if (ideal_8u.at<uint8_t>(i, j) > 100 &&
+          result_8u.at<uint8_t>(i, j) < 200) {
+        // is an edge pixel but wasn't detected
+        ++false_negative;
+      }
+      if (ideal_8u.at<uint8_t>(i, j) < 100 &&
+          result_8u.at<uint8_t>(i, j) > 200) {
+        // is not an edge pixel but is detected
+        ++false_positive;
+      }
+      if (ideal_8u.at<uint8_t>(i, j) > 100) {
+        ++ideal_edge_num;
+      }
+      if (result_8u.at<uint8_t>(i, j) > 200) {
+        ++result_edge_num;
+      }
+    }
+  }
+
+  int edge_num = std::max(result_edge_num, ideal_edge_num);
+
+  return std::make_pair((double)false_negative / edge_num,
+                        (double)false_positive / edge_num);
+}
+
+#endif
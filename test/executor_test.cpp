@@ -0,0 +1,186 @@
+#include <executor.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+#include "test_volume.h"
+
+// Cancellation and back-pressure of EdgeDetectionExecutor
+
+namespace {
+
+bool IsCancelled(std::future<std::vector<cv::Mat>>& result) {
+  try {
+    result.get();
+  } catch (const DetectionCancelled&) {
+    return true;
+  }
+  return false;
+}
+
+// Keeps the worker that finished a job inside its callback until Open();
+// has to outlive the executor
+class Gate {
+ public:
+  Gate() : opened_(open_.get_future().share()) {}
+
+  EdgeDetectionExecutor::Callback Callback() {
+    return [this](DetectionJob&) {
+      entered_.set_value();
+      opened_.wait();
+    };
+  }
+
+  void WaitEntered() { entered_.get_future().wait(); }
+  void Open() { open_.set_value(); }
+
+ private:
+  std::promise<void> entered_;
+  std::promise<void> open_;
+  std::shared_future<void> opened_;
+};
+
+// Submits from another thread and reports whether Submit has returned
+class BlockedSubmit {
+ public:
+  BlockedSubmit(EdgeDetectionExecutor& executor,
+                const std::vector<cv::Mat>& images) {
+    thread_ = std::thread([this, &executor, images]() {
+      job_ = executor.Submit(images);
+      returned_ = true;
+    });
+  }
+
+  ~BlockedSubmit() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  bool Returned() const { return returned_; }
+  void Join() { thread_.join(); }
+
+  std::shared_ptr<DetectionJob> job() { return job_; }
+
+ private:
+  std::thread thread_;
+  std::atomic<bool> returned_{false};
+  std::shared_ptr<DetectionJob> job_;
+};
+
+const auto kBlockTime = std::chrono::milliseconds(200);
+
+void TestQueuedCancel() {
+  std::vector<cv::Mat> images = RandomVolume(6, 24, 24, 1);
+  Gate gate;
+  EdgeDetectionExecutor executor(1);
+  std::shared_ptr<DetectionJob> first =
+      executor.Submit(images, {}, gate.Callback());
+  gate.WaitEntered();
+
+  // the only worker is busy, so the second job stays in the queue
+  std::atomic<int> callbacks{0};
+  std::shared_ptr<DetectionJob> queued = executor.Submit(
+      images, {}, [&callbacks](DetectionJob&) { callbacks++; });
+  queued->Cancel();
+  Check(queued->IsCancelled(), "queued job is marked as cancelled");
+  Check(callbacks == 1, "queued job calls back on cancellation");
+  Check(IsCancelled(queued->Result()), "queued job reports cancellation");
+
+  gate.Open();
+  Check(first->Result().get().size() == images.size(),
+        "job before the cancelled one finishes");
+}
+
+void TestRunningCancel() {
+  // large enough to be still running when it is cancelled
+  std::vector<cv::Mat> images = RandomVolume(48, 192, 192, 2);
+  EdgeDetectionExecutor executor(1);
+  std::shared_ptr<DetectionJob> job = executor.Submit(images);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  auto start = std::chrono::steady_clock::now();
+  job->Cancel();
+  Check(IsCancelled(job->Result()), "running job reports cancellation");
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << "Running job stopped " << elapsed << " s after cancellation"
+            << std::endl;
+
+  // a cancelled job releases its worker for the next one
+  std::vector<cv::Mat> small = RandomVolume(5, 16, 16, 3);
+  Check(executor.Submit(small)->Result().get().size() == small.size(),
+        "job after the cancelled one finishes");
+}
+
+void TestCancelledDetection() {
+  std::vector<cv::Mat> images = RandomVolume(5, 16, 16, 4);
+  std::atomic<bool> cancelled{true};
+  Check(Canny3D(false)
+            .DetectEdges(images, 50, 150, 1e-5, 5, &cancelled)
+            .empty(),
+        "cancelled detection returns no slices");
+}
+
+void TestMaxInFlight() {
+  std::vector<cv::Mat> images = RandomVolume(5, 16, 16, 5);
+  Gate gate;
+  EdgeDetectionExecutor executor(1, 1);
+  std::shared_ptr<DetectionJob> first =
+      executor.Submit(images, {}, gate.Callback());
+  gate.WaitEntered();
+
+  // the first job has released its place; the second one takes it
+  std::shared_ptr<DetectionJob> second = executor.Submit(images);
+  BlockedSubmit third(executor, images);
+  std::this_thread::sleep_for(kBlockTime);
+  Check(!third.Returned(), "Submit blocks at max_in_flight");
+
+  second->Cancel();
+  third.Join();
+  Check(third.Returned(), "Submit returns when a job leaves");
+
+  gate.Open();
+  Check(third.job()->Result().get().size() == images.size(),
+        "blocked job finishes");
+}
+
+void TestMemoryLimit() {
+  std::vector<cv::Mat> images = RandomVolume(5, 16, 16, 6);
+  size_t memory = EdgeDetectionExecutor::EstimateMemory(images, {});
+  Gate gate;
+  EdgeDetectionExecutor executor(1, 0, memory + memory / 2);
+  std::shared_ptr<DetectionJob> first =
+      executor.Submit(images, {}, gate.Callback());
+  gate.WaitEntered();
+
+  std::shared_ptr<DetectionJob> second = executor.Submit(images);
+  BlockedSubmit third(executor, images);
+  std::this_thread::sleep_for(kBlockTime);
+  Check(!third.Returned(), "Submit blocks at the memory limit");
+
+  second->Cancel();
+  third.Join();
+  Check(third.Returned(), "Submit returns when memory is released");
+
+  gate.Open();
+  Check(third.job()->Result().get().size() == images.size(),
+        "blocked job finishes");
+}
+
+}  // namespace
+
+int main() {
+  TestQueuedCancel();
+  TestRunningCancel();
+  TestCancelledDetection();
+  TestMaxInFlight();
+  TestMemoryLimit();
+
+  return TestResult("executor_test");
+}
@@ -0,0 +1,98 @@
+#include <incremental.h>
+
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+#include "test_volume.h"
+
+// Replays random sequences of appended and replaced slices and compares
+// IncrementalCanny3D with DetectEdges on the whole stack after every step
+
+namespace {
+
+const int kRows = 40;
+const int kCols = 40;
+const int kSteps = 12;
+
+const int kLowThreshold = 40;
+const int kHighThreshold = 180;
+const double kSobelCoef = 1;
+
+// slices cut from a random volume, so that neighbouring ones are related
+std::vector<cv::Mat> NewSlices(int count, std::mt19937& rng) {
+  std::vector<cv::Mat> volume = RandomVolume(count + 4, kRows, kCols, rng());
+  return std::vector<cv::Mat>(volume.begin() + 2, volume.end() - 2);
+}
+
+void TestSequence(int blur_ksize, unsigned seed) {
+  std::mt19937 rng(seed);
+  IncrementalCanny3D session(kLowThreshold, kHighThreshold, kSobelCoef,
+                             blur_ksize);
+  std::vector<cv::Mat> images;
+
+  for (int step = 0; step < kSteps; step++) {
+    std::vector<cv::Mat> slices;
+    std::string action;
+    if (images.size() < 3 || rng() % 2 == 0) {
+      // mostly one or two slices, like a scanner delivering them
+      int count = images.empty() ? 3 + rng() % 4 : 1 + rng() % 2;
+      slices = NewSlices(count, rng);
+      images.insert(images.end(), slices.begin(), slices.end());
+      session.AppendSlices(slices);
+      action = "append " + std::to_string(count);
+    } else {
+      size_t first;
+      switch (rng() % 3) {
+        case 0:
+          first = 0;
+          break;
+        case 1:
+          first = images.size() - 1;
+          break;
+        default:
+          first = rng() % images.size();
+      }
+      // may extend the volume past its last slice
+      int count = 1 + rng() % 3;
+      slices = NewSlices(count, rng);
+      images.resize(std::max(images.size(), first + count));
+      std::copy(slices.begin(), slices.end(), images.begin() + first);
+      session.ReplaceSlices(first, slices);
+      action = "replace " + std::to_string(count) + " from " +
+               std::to_string(first);
+    }
+
+    std::vector<cv::Mat> stack = images;
+    std::vector<cv::Mat> expected = Canny3D(false).DetectEdges(
+        stack, kLowThreshold, kHighThreshold, kSobelCoef, blur_ksize);
+    Check(Equal(session.Edges(), expected),
+          "ksize " + std::to_string(blur_ksize) + ", seed " +
+              std::to_string(seed) + ", step " + std::to_string(step) + ": " +
+              action);
+  }
+
+  bool thrown = false;
+  try {
+    session.ReplaceSlices(images.size() + 1, NewSlices(1, rng));
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  Check(thrown, "replacing past the end of the volume throws");
+  Check(session.size() == images.size(), "rejected slices are not added");
+}
+
+}  // namespace
+
+int main() {
+  for (int blur_ksize : {1, 3, 5}) {
+    for (unsigned seed = 1; seed <= 5; seed++) {
+      TestSequence(blur_ksize, seed);
+    }
+  }
+
+  return TestResult("incremental_test");
+}
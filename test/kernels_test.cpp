@@ -0,0 +1,172 @@
+#include <kernels.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+// Checks every kernel variant available on this machine against the scalar
+// reference on random rows: all results have to be bit exact
+
+namespace {
+
+const int kIterations = 2000;
+
+std::string Variant(const Kernels& kernels) {
+  return std::string(" (") + kernels.name + ")";
+}
+
+template <class T>
+bool EqualRows(const std::vector<T>& a, const std::vector<T>& b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+void TestBlur(const Kernels& kernels, std::mt19937& rng) {
+  // the widths are not multiples of the vector width on purpose
+  int cols = 3 + rng() % 150;
+  int ksize = 1 + 2 * (rng() % 3);
+  int r = ksize / 2;
+  if (cols <= 2 * r) return;
+
+  std::vector<std::vector<double>> rows(ksize * ksize,
+                                        std::vector<double>(cols));
+  std::vector<const double*> row_ptrs;
+  for (std::vector<double>& row : rows) {
+    for (double& value : row) value = rng() % 256;
+    row_ptrs.push_back(row.data());
+  }
+  std::vector<double> filter(ksize * ksize * ksize);
+  for (double& value : filter) value = (rng() % 1000) / 997.0;
+
+  std::vector<double> expected(cols, 0);
+  std::vector<double> result(cols, 0);
+  ScalarKernels().blur_row(row_ptrs.data(), filter.data(), ksize,
+                           expected.data(), r, cols - r);
+  kernels.blur_row(row_ptrs.data(), filter.data(), ksize, result.data(), r,
+                   cols - r);
+  Check(EqualRows(expected, result), "blur_row" + Variant(kernels));
+}
+
+void TestSobel(const Kernels& kernels, std::mt19937& rng, int iteration) {
+  int cols = 3 + rng() % 150;
+  std::vector<std::vector<int32_t>> rows(9, std::vector<int32_t>(cols));
+  std::vector<const int32_t*> row_ptrs;
+  for (std::vector<int32_t>& row : rows) {
+    for (int32_t& value : row) {
+      // small ranges give many zero gradients and ties between directions
+      switch (iteration % 3) {
+        case 0:
+          value = rng() % 3;
+          break;
+        case 1:
+          value = rng() % 256;
+          break;
+        default:
+          value = (int)(rng() % 2000) - 700;
+      }
+    }
+    row_ptrs.push_back(row.data());
+  }
+
+  std::vector<int32_t> magnitude(cols, 0), gx(cols, 0), gy(cols, 0),
+      gz(cols, 0);
+  std::vector<int32_t> magnitude2(cols, 0), gx2(cols, 0), gy2(cols, 0),
+      gz2(cols, 0);
+  ScalarKernels().sobel_row(row_ptrs.data(), magnitude.data(), gx.data(),
+                            gy.data(), gz.data(), 1, cols - 1);
+  kernels.sobel_row(row_ptrs.data(), magnitude2.data(), gx2.data(),
+                    gy2.data(), gz2.data(), 1, cols - 1);
+  Check(EqualRows(magnitude, magnitude2) && EqualRows(gx, gx2) &&
+            EqualRows(gy, gy2) && EqualRows(gz, gz2),
+        "sobel_row" + Variant(kernels));
+
+  std::vector<int32_t> magnitude_only(cols, 0);
+  kernels.sobel_row(row_ptrs.data(), magnitude_only.data(), nullptr, nullptr,
+                    nullptr, 1, cols - 1);
+  Check(EqualRows(magnitude, magnitude_only),
+        "sobel_row without components" + Variant(kernels));
+
+  std::vector<int32_t> dir_x(cols, 0), dir_y(cols, 0), dir_z(cols, 0);
+  std::vector<int32_t> dir_x2(cols, 0), dir_y2(cols, 0), dir_z2(cols, 0);
+  ScalarKernels().quantize_direction_row(gx.data(), gy.data(), gz.data(),
+                                         dir_x.data(), dir_y.data(),
+                                         dir_z.data(), 1, cols - 1);
+  kernels.quantize_direction_row(gx.data(), gy.data(), gz.data(),
+                                 dir_x2.data(), dir_y2.data(), dir_z2.data(),
+                                 1, cols - 1);
+  Check(EqualRows(dir_x, dir_x2) && EqualRows(dir_y, dir_y2) &&
+            EqualRows(dir_z, dir_z2),
+        "quantize_direction_row" + Variant(kernels));
+}
+
+void TestNms(const Kernels& kernels, std::mt19937& rng) {
+  int cols = 3 + rng() % 150;
+  std::vector<std::vector<int32_t>> first(3, std::vector<int32_t>(cols));
+  std::vector<std::vector<int32_t>> second(3, std::vector<int32_t>(cols));
+  const int32_t* first_rows[3];
+  const int32_t* second_rows[3];
+  for (int row = 0; row < 3; row++) {
+    for (int32_t& value : first[row]) value = rng() % 300;
+    for (int32_t& value : second[row]) value = rng() % 300;
+    first_rows[row] = first[row].data();
+    second_rows[row] = second[row].data();
+  }
+  std::vector<int32_t> grad(cols), dir_x(cols), dir_y(cols), dir_z(cols);
+  for (int j = 0; j < cols; j++) {
+    grad[j] = rng() % 300;
+    dir_x[j] = (int)(rng() % 3) - 1;
+    dir_y[j] = (int)(rng() % 3) - 1;
+    dir_z[j] = (int)(rng() % 3) - 1;
+  }
+
+  // the result is written in place, like in Canny3D
+  std::vector<int32_t> expected = grad;
+  std::vector<int32_t> result = grad;
+  ScalarKernels().nms_row(expected.data(), dir_x.data(), dir_y.data(),
+                          dir_z.data(), first_rows, second_rows,
+                          expected.data(), 1, cols - 1);
+  kernels.nms_row(result.data(), dir_x.data(), dir_y.data(), dir_z.data(),
+                  first_rows, second_rows, result.data(), 1, cols - 1);
+  Check(EqualRows(expected, result), "nms_row" + Variant(kernels));
+}
+
+void TestThreshold(const Kernels& kernels, std::mt19937& rng) {
+  int cols = 1 + rng() % 200;
+  std::vector<uint8_t> row(cols);
+  for (uint8_t& value : row) value = rng() % 256;
+  // thresholds outside of [0, 255] are included
+  int low_threshold = (int)(rng() % 320) - 30;
+  int high_threshold = (int)(rng() % 320) - 30;
+
+  std::vector<uint8_t> expected = row;
+  std::vector<uint8_t> result = row;
+  ScalarKernels().threshold_row(expected.data(), low_threshold,
+                                high_threshold, 0, cols);
+  kernels.threshold_row(result.data(), low_threshold, high_threshold, 0,
+                        cols);
+  Check(EqualRows(expected, result),
+        "threshold_row " + std::to_string(low_threshold) + " " +
+            std::to_string(high_threshold) + Variant(kernels));
+}
+
+}  // namespace
+
+int main() {
+  for (const Kernels* kernels : AvailableKernels()) {
+    std::cout << "Testing " << kernels->name << " kernels" << std::endl;
+    std::mt19937 rng(2024);
+    for (int iteration = 0; iteration < kIterations; iteration++) {
+      TestBlur(*kernels, rng);
+      TestSobel(*kernels, rng, iteration);
+      TestNms(*kernels, rng);
+      TestThreshold(*kernels, rng);
+    }
+  }
+
+  return TestResult("kernels_test");
+}
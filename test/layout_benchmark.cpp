@@ -0,0 +1,200 @@
+#include <brick.h>
+#include <canny.h>
+#include <hysteresis.h>
+#include <kernels.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "test_util.h"
+
+// Times the hysteresis on the slice stack and on the bricked layout of the
+// demo volume and reads cache and dTLB miss counters around it.
+// Usage: layout_benchmark [slices_dir]
+
+namespace {
+
+const int kRepeats = 5;
+
+// hardware counter of the calling thread, -1 if it cannot be read
+class Counter {
+ public:
+  Counter(uint32_t type, uint64_t config) {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  ~Counter() {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void Start() {
+#ifdef __linux__
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  long long Stop() {
+    long long value = -1;
+#ifdef __linux__
+    if (fd_ < 0) return value;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd_, &value, sizeof(value)) != sizeof(value)) value = -1;
+#endif
+    return value;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+struct Measurement {
+  double seconds = 0;
+  long long cache_misses = -1;
+  long long l1d_misses = -1;
+  long long dtlb_misses = -1;
+};
+
+// the fastest of kRepeats runs; prepare() is not measured
+template <class Prepare, class Run>
+Measurement Measure(Prepare prepare, Run run) {
+#ifdef __linux__
+  const uint64_t kReadMiss =
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  Counter cache(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  Counter l1d(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | kReadMiss);
+  Counter dtlb(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | kReadMiss);
+#else
+  Counter cache(0, 0), l1d(0, 0), dtlb(0, 0);
+#endif
+
+  Measurement best;
+  for (int repeat = 0; repeat < kRepeats; repeat++) {
+    prepare();
+    Measurement current;
+    cache.Start();
+    l1d.Start();
+    dtlb.Start();
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    current.dtlb_misses = dtlb.Stop();
+    current.l1d_misses = l1d.Stop();
+    current.cache_misses = cache.Stop();
+    current.seconds = std::chrono::duration<double>(end - start).count();
+    if (repeat == 0 || current.seconds < best.seconds) best = current;
+  }
+  return best;
+}
+
+void Print(const std::string& name, const Measurement& m) {
+  auto counter = [](long long value) {
+    return value < 0 ? std::string("n/a") : std::to_string(value);
+  };
+  std::cout << std::left << std::setw(28) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1)
+            << m.seconds * 1000 << std::setw(14) << counter(m.cache_misses)
+            << std::setw(14) << counter(m.l1d_misses) << std::setw(14)
+            << counter(m.dtlb_misses) << std::endl;
+}
+
+std::vector<cv::Mat> Clone(const std::vector<cv::Mat>& images) {
+  std::vector<cv::Mat> result;
+  for (const cv::Mat& img : images) result.push_back(img.clone());
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string dir = argc > 1 ? argv[1] : "../../src/slices";
+
+  // the volume of the demo, see src/main.cpp
+  std::vector<cv::Mat> images;
+  for (size_t i = 1100; i < 1116; i++) {
+    cv::Mat img = cv::imread(dir + "/" + std::to_string(i) + ".png",
+                             cv::IMREAD_UNCHANGED);
+    if (img.empty()) {
+      std::cerr << "Cannot read " << dir << "/" << i << ".png" << std::endl;
+      return 1;
+    }
+    images.push_back(img);
+  }
+
+  // the stages before hysteresis with the parameters of the demo
+  Canny3D canny(false);
+  std::vector<cv::Mat> blurred = GaussianBlur3D(images).Blur(5);
+  SobelOperator sop(blurred, 1);
+  std::vector<cv::Mat> states = canny.NonMaximumSuppression(sop);
+  const Kernels& kernels = ActiveKernels();
+  for (size_t img_i = 1; img_i + 1 < states.size(); img_i++) {
+    for (int i = 0; i < states[img_i].rows; i++) {
+      kernels.threshold_row(states[img_i].ptr<uint8_t>(i), 40, 180, 0,
+                            states[img_i].cols);
+    }
+  }
+
+  std::cout << images.size() << " slices of " << images[0].cols << "x"
+            << images[0].rows << ", best of " << kRepeats << " runs"
+            << std::endl;
+  std::cout << std::left << std::setw(28) << "layout" << std::right
+            << std::setw(10) << "ms" << std::setw(14) << "cache-misses"
+            << std::setw(14) << "L1d-misses" << std::setw(14)
+            << "dTLB-misses" << std::endl;
+
+  std::vector<cv::Mat> slice_edges;
+  Print("slices", Measure([&]() { slice_edges = Clone(states); },
+                          [&]() {
+                            SliceStack volume(slice_edges);
+                            TrackEdges(volume);
+                          }));
+
+  BrickVolume<uint8_t> bricks(1, 1, 1);
+  Print("bricks, tracking only",
+        Measure([&]() { bricks = BrickVolume<uint8_t>::FromSlices(states); },
+                [&]() { TrackEdges(bricks); }));
+
+  // what Canny3D::UseBrickedLayout does
+  std::vector<cv::Mat> brick_edges;
+  Print("bricks with conversion",
+        Measure([&]() { brick_edges = Clone(states); },
+                [&]() {
+                  BrickVolume<uint8_t> volume =
+                      BrickVolume<uint8_t>::FromSlices(brick_edges);
+                  TrackEdges(volume);
+                  volume.ToSlices(brick_edges);
+                }));
+
+  if (!Equal(slice_edges, brick_edges) ||
+      !Equal(slice_edges, bricks.ToSlices())) {
+    std::cerr << "Layouts give different edges" << std::endl;
+    return 1;
+  }
+}
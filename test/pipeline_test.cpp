@@ -0,0 +1,123 @@
+#include <canny.h>
+#include <kernels.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+#include "test_volume.h"
+
+// Runs the whole detector with the kernel variant forced by CANNY3D_KERNELS.
+// The scalar run writes its results to the reference file, the runs of the
+// vectorized variants have to reproduce them bit exactly.
+// Usage: pipeline_test reference_file
+
+namespace {
+
+// returned when the forced variant is not supported by the CPU
+const int kSkipped = 77;
+
+// volume sizes do not divide by the vector widths, so the row tails run too
+struct Case {
+  int depth, rows, cols;
+  unsigned seed;
+  double sobel_coef;
+  int blur_ksize;
+  bool coarse_to_fine;
+};
+
+const Case kCases[] = {
+    {12, 37, 53, 1, 1e-5, 5, false}, {9, 64, 71, 2, 1, 3, false},
+    {14, 45, 45, 3, 0.5, 7, false},  {16, 48, 61, 4, 1, 5, true},
+};
+
+std::vector<std::vector<cv::Mat>> RunCases() {
+  std::vector<std::vector<cv::Mat>> results;
+  for (const Case& c : kCases) {
+    std::vector<cv::Mat> images = RandomVolume(c.depth, c.rows, c.cols, c.seed);
+    Canny3D canny(false);
+    results.push_back(c.coarse_to_fine
+                          ? canny.DetectEdgesCoarseToFine(
+                                images, 40, 180, c.sobel_coef, c.blur_ksize)
+                          : canny.DetectEdges(images, 40, 180, c.sobel_coef,
+                                              c.blur_ksize));
+  }
+  return results;
+}
+
+void WriteVolumes(std::ofstream& out,
+                  const std::vector<std::vector<cv::Mat>>& volumes) {
+  for (const std::vector<cv::Mat>& volume : volumes) {
+    int header[] = {(int)volume.size()};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const cv::Mat& img : volume) {
+      int mat_header[] = {img.rows, img.cols, img.type()};
+      out.write(reinterpret_cast<const char*>(mat_header),
+                sizeof(mat_header));
+      for (int i = 0; i < img.rows; i++) {
+        out.write(reinterpret_cast<const char*>(img.ptr<uint8_t>(i)),
+                  img.cols * img.elemSize());
+      }
+    }
+  }
+}
+
+std::vector<std::vector<cv::Mat>> ReadVolumes(std::ifstream& in) {
+  std::vector<std::vector<cv::Mat>> volumes;
+  for (size_t case_i = 0; case_i < std::size(kCases); case_i++) {
+    int size = 0;
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    std::vector<cv::Mat> volume;
+    for (int img_i = 0; in && img_i < size; img_i++) {
+      int mat_header[3] = {0, 0, 0};
+      in.read(reinterpret_cast<char*>(mat_header), sizeof(mat_header));
+      cv::Mat img(mat_header[0], mat_header[1], mat_header[2]);
+      for (int i = 0; i < img.rows; i++) {
+        in.read(reinterpret_cast<char*>(img.ptr<uint8_t>(i)),
+                img.cols * img.elemSize());
+      }
+      volume.push_back(img);
+    }
+    volumes.push_back(volume);
+  }
+  return volumes;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cout << "Usage: pipeline_test reference_file" << std::endl;
+    return 1;
+  }
+  const char* forced = std::getenv("CANNY3D_KERNELS");
+  std::string variant = forced != nullptr ? forced : "";
+  if (FindKernels(variant) == nullptr) {
+    std::cout << "CANNY3D_KERNELS=" << variant
+              << " is not supported on this machine, skipped" << std::endl;
+    return kSkipped;
+  }
+  Check(ActiveKernels().name == variant, "CANNY3D_KERNELS selects " + variant);
+
+  std::vector<std::vector<cv::Mat>> results = RunCases();
+  if (variant == "scalar") {
+    std::ofstream out(argv[1], std::ios::binary);
+    WriteVolumes(out, results);
+    Check(bool(out), std::string("writing ") + argv[1]);
+    return TestResult("pipeline_test (scalar)");
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  Check(bool(in), std::string("reading ") + argv[1]);
+  std::vector<std::vector<cv::Mat>> reference = ReadVolumes(in);
+  Check(bool(in), "reference of every case");
+  for (size_t case_i = 0; case_i < results.size(); case_i++) {
+    Check(Equal(results[case_i], reference[case_i]),
+          "case " + std::to_string(case_i) + " equals the scalar result");
+  }
+  return TestResult("pipeline_test (" + variant + ")");
+}
@@ -0,0 +1,54 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstring>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Failed checks of the test program, main returns nonzero if there are any
+inline int& Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+// Works in release builds too, unlike assert
+inline void Check(bool ok, const std::string& what) {
+  if (!ok) {
+    ++Failures();
+    std::cout << "FAILED: " << what << std::endl;
+  }
+}
+
+// Prints the summary line and gives the exit code of the test program
+inline int TestResult(const std::string& name) {
+  std::cout << name << (Failures() == 0 ? ": passed" : ": failed")
+            << std::endl;
+  return Failures() == 0 ? 0 : 1;
+}
+
+// Bit-exact comparison of images
+inline bool Equal(const cv::Mat& a, const cv::Mat& b) {
+  if (a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) {
+    return false;
+  }
+  for (int i = 0; i < a.rows; i++) {
+    if (std::memcmp(a.ptr<uint8_t>(i), b.ptr<uint8_t>(i),
+                    a.cols * a.elemSize()) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool Equal(const std::vector<cv::Mat>& a,
+                  const std::vector<cv::Mat>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t img_i = 0; img_i < a.size(); img_i++) {
+    if (!Equal(a[img_i], b[img_i])) return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef TEST_VOLUME_H
+#define TEST_VOLUME_H
+
+#include <algorithm>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <vector>
+
+// Synthetic CT-like volume: a few balls of different brightness on a dark
+// background with some noise
+inline std::vector<cv::Mat> RandomVolume(int depth, int rows, int cols,
+                                         unsigned seed) {
+  std::mt19937 rng(seed);
+  struct Ball {
+    double z, y, x, r;
+    int value;
+  };
+  std::vector<Ball> balls;
+  for (int i = 0; i < 4; i++) {
+    Ball ball;
+    ball.z = rng() % depth;
+    ball.y = rng() % rows;
+    ball.x = rng() % cols;
+    ball.r = 2 + rng() % (1 + std::min(rows, cols) / 3);
+    ball.value = 80 + rng() % 170;
+    balls.push_back(ball);
+  }
+
+  std::vector<cv::Mat> images;
+  for (int z = 0; z < depth; z++) {
+    cv::Mat img = cv::Mat::zeros(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; y++) {
+      uint8_t* row = img.ptr<uint8_t>(y);
+      for (int x = 0; x < cols; x++) {
+        int value = rng() % 8;
+        for (const Ball& ball : balls) {
+          double dz = z - ball.z, dy = y - ball.y, dx = x - ball.x;
+          if (dz * dz + dy * dy + dx * dx <= ball.r * ball.r) {
+            value = std::max(value, ball.value);
+          }
+        }
+        row[x] = value;
+      }
+    }
+    images.push_back(img);
+  }
+  return images;
+}
+
+#endif